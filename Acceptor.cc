@@ -21,7 +21,7 @@ Acceptor::Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reusepor
     , acceptChannel_(loop, acceptSocket_.fd())
     , listening_(false) {
     acceptSocket_.setReuseAddr(true);
-    acceptSocket_.setReusePort(true);
+    acceptSocket_.setReusePort(reuseport);
     acceptSocket_.bindAddress(listenAddr); // bind
     // TcpServer::start() Acceptor.listen  有新用户的连接，要执行一个回调（connfd=》channel=》subloop）
     // baseLoop => acceptChannel_(listenfd) => 
@@ -35,9 +35,15 @@ Acceptor::~Acceptor() {
 
 
 
-void Acceptor::listen() {
+void Acceptor::listenSocket() {
     listening_ = true;
     acceptSocket_.listen(); // listen
+}
+
+void Acceptor::listen() {
+    if (!listening_) {
+        listenSocket();
+    }
     acceptChannel_.enableReading();
 }
 
@@ -17,7 +17,13 @@ public:
         newConnectionCallback_ = cb;
     }
 
+    // 在loop线程中调用，开始监听并注册到loop
     void listen();
+    // 只执行listen系统调用，可以在任意线程调用
+    // 分片模式下各socket加入SO_REUSEPORT组的顺序由listen的先后决定，需要依次调用
+    void listenSocket();
+    // 见Socket::setReusePortCpuSteering
+    bool setReusePortCpuSteering(int numSockets) { return acceptSocket_.setReusePortCpuSteering(numSockets); };
 
     bool listening() const { return listening_; };
 private:
@@ -0,0 +1,58 @@
+#include "AdaptiveRecvSizer.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// 16, 32, ... 496 按16递增，之后512, 1024, ... 按2倍递增
+std::vector<size_t> makeSizeTable() {
+    std::vector<size_t> table;
+    for (size_t i = 16; i < 512; i += 16) {
+        table.push_back(i);
+    }
+    for (size_t i = 512; i <= AdaptiveRecvSizer::kMaximum; i <<= 1) {
+        table.push_back(i);
+    }
+    return table;
+}
+
+const std::vector<size_t> kSizeTable = makeSizeTable();
+
+// 返回第一个不小于size的档位下标
+int sizeTableIndex(size_t size) {
+    auto it = std::lower_bound(kSizeTable.begin(), kSizeTable.end(), size);
+    if (it == kSizeTable.end()) {
+        return static_cast<int>(kSizeTable.size()) - 1;
+    }
+    return static_cast<int>(it - kSizeTable.begin());
+}
+
+}
+
+AdaptiveRecvSizer::AdaptiveRecvSizer()
+    : minIndex_(sizeTableIndex(kMinimum))
+    , maxIndex_(sizeTableIndex(kMaximum))
+    , index_(sizeTableIndex(kInitial))
+    , nextReceiveBufferSize_(kSizeTable[index_])
+    , decreaseNow_(false) {
+
+}
+
+void AdaptiveRecvSizer::record(size_t actualReadBytes) {
+    if (actualReadBytes <= kSizeTable[std::max(0, index_ - kIndexDecrement)]) {
+        if (decreaseNow_) {
+            index_ = std::max(index_ - kIndexDecrement, minIndex_);
+            nextReceiveBufferSize_ = kSizeTable[index_];
+            decreaseNow_ = false;
+        }
+        else {
+            decreaseNow_ = true;
+        }
+    }
+    else if (actualReadBytes >= nextReceiveBufferSize_) {
+        index_ = std::min(index_ + kIndexIncrement, maxIndex_);
+        nextReceiveBufferSize_ = kSizeTable[index_];
+        decreaseNow_ = false;
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stddef.h>
+
+/*
+    参照Netty的AdaptiveRecvByteBufAllocator，根据最近几次读到的字节数
+    预测下一次readv的大小：
+    - 一次就读满了预测值，说明对端发得快，直接把预测值放大几档
+    - 连续两次都读不到下一档的大小，才缩小一档，避免来回抖动
+*/
+class AdaptiveRecvSizer {
+public:
+    static const size_t kMinimum = 64;
+    static const size_t kInitial = 2048;
+    static const size_t kMaximum = 65536;
+
+    AdaptiveRecvSizer();
+
+    // 下一次readv预计读取的字节数
+    size_t guess() const { return nextReceiveBufferSize_; };
+
+    // 记录本次实际读取的字节数，调整下一次的预测值
+    void record(size_t actualReadBytes);
+
+private:
+    static const int kIndexIncrement = 4;
+    static const int kIndexDecrement = 1;
+
+    int minIndex_;
+    int maxIndex_;
+    int index_;
+    size_t nextReceiveBufferSize_;
+    bool decreaseNow_;
+};
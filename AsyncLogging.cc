@@ -0,0 +1,132 @@
+#include "AsyncLogging.h"
+#include "LogFile.h"
+
+#include <chrono>
+#include <stdio.h>
+
+AsyncLogging::AsyncLogging(const std::string &basename,
+                           off_t rollSize,
+                           int flushInterval,
+                           size_t maxPendingBuffers)
+    : basename_(basename)
+    , rollSize_(rollSize)
+    , flushInterval_(flushInterval)
+    , maxPendingBuffers_(maxPendingBuffers)
+    , running_(false)
+    , thread_(std::bind(&AsyncLogging::threadFunc, this), "Logging")
+    , currentBuffer_(new Buffer)
+    , nextBuffer_(new Buffer)
+    , droppedMessages_(0) {
+    buffers_.reserve(maxPendingBuffers_);
+}
+
+AsyncLogging::~AsyncLogging() {
+    if (running_) {
+        stop();
+    }
+}
+
+void AsyncLogging::start() {
+    running_ = true;
+    thread_.start();
+}
+
+void AsyncLogging::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cond_.notify_one();
+    thread_.join();
+}
+
+void AsyncLogging::flush() {
+    cond_.notify_one();
+}
+
+void AsyncLogging::append(const char* logline, int len) {
+    size_t n = static_cast<size_t>(len);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (currentBuffer_->avail() > n) {
+        currentBuffer_->append(logline, n);
+        return;
+    }
+
+    // 后台线程写不过来，丢弃而不是无限制地分配新缓冲区
+    if (buffers_.size() >= maxPendingBuffers_ || n >= static_cast<size_t>(kLargeBuffer)) {
+        droppedMessages_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    buffers_.push_back(std::move(currentBuffer_));
+    if (nextBuffer_) {
+        currentBuffer_ = std::move(nextBuffer_);
+    }
+    else {
+        currentBuffer_.reset(new Buffer); // 很少发生，前端写得太快，两块缓冲都用完了
+    }
+    currentBuffer_->append(logline, n);
+    cond_.notify_one();
+}
+
+void AsyncLogging::threadFunc() {
+    LogFile output(basename_, rollSize_, flushInterval_);
+    BufferPtr newBuffer1(new Buffer);
+    BufferPtr newBuffer2(new Buffer);
+    BufferVector buffersToWrite;
+    buffersToWrite.reserve(maxPendingBuffers_ + 1);
+    int64_t reportedDropped = 0;
+
+    bool running = true;
+    while (running) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (buffers_.empty() && running_) {
+                cond_.wait_for(lock, std::chrono::seconds(flushInterval_));
+            }
+            // stop之后还会再走一轮，把剩下的日志写完
+            running = running_;
+            buffers_.push_back(std::move(currentBuffer_));
+            currentBuffer_ = std::move(newBuffer1);
+            buffersToWrite.swap(buffers_);
+            if (!nextBuffer_) {
+                nextBuffer_ = std::move(newBuffer2);
+            }
+        }
+
+        int64_t dropped = droppedMessages_.load(std::memory_order_relaxed);
+        if (dropped != reportedDropped) {
+            char buf[128];
+            int len = snprintf(buf, sizeof buf, "Dropped %ld log messages, %ld in total\n",
+                               static_cast<long>(dropped - reportedDropped), static_cast<long>(dropped));
+            output.append(buf, len);
+            reportedDropped = dropped;
+        }
+
+        for (const BufferPtr &buffer : buffersToWrite) {
+            output.append(buffer->data(), buffer->length());
+        }
+
+        // 留两块缓冲给下一轮复用，多出来的释放掉
+        if (buffersToWrite.size() > 2) {
+            buffersToWrite.resize(2);
+        }
+        if (!newBuffer1) {
+            newBuffer1 = std::move(buffersToWrite.back());
+            buffersToWrite.pop_back();
+            newBuffer1->reset();
+        }
+        if (!newBuffer2) {
+            if (!buffersToWrite.empty()) {
+                newBuffer2 = std::move(buffersToWrite.back());
+                buffersToWrite.pop_back();
+                newBuffer2->reset();
+            }
+            else {
+                newBuffer2.reset(new Buffer);
+            }
+        }
+        buffersToWrite.clear();
+        output.flush();
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+#include "nocopyable.h"
+#include "LogStream.h"
+#include "Thread.h"
+
+/*
+    异步日志后端，双缓冲：
+    - 前端线程append时只在锁内把日志memcpy进预分配的当前缓冲区(4MB)
+    - 当前缓冲区写满后挂到待写队列，换上备用缓冲区，并唤醒后台线程
+    - 后台线程把待写队列整体换出来，在锁外顺序写入LogFile，再把缓冲区还回来复用
+    待写队列超过maxPendingBuffers时直接丢弃新日志并计数，内存占用有上限，
+    丢弃的条数由后台线程补写一行提示
+
+    用法：
+        AsyncLogging* g_asyncLog = new AsyncLogging("server", 500 * 1000 * 1000);
+        g_asyncLog->start();
+        Logger::setOutput([](const char* msg, int len) { g_asyncLog->append(msg, len); });
+        Logger::setFlush([]() { g_asyncLog->flush(); });
+*/
+class AsyncLogging: nocopyable {
+public:
+    AsyncLogging(const std::string &basename,
+                 off_t rollSize,
+                 int flushInterval = 3,
+                 size_t maxPendingBuffers = 16);
+    ~AsyncLogging();
+
+    // 前端调用，线程安全
+    void append(const char* logline, int len);
+    // 不等待写完，只是让后台线程立刻醒来，ERROR级别的日志尽快落盘
+    void flush();
+
+    void start();
+    // 停止后台线程，退出前把剩下的日志全部写完
+    void stop();
+
+    // 因为积压过多被丢弃的日志条数
+    int64_t droppedMessages() const { return droppedMessages_.load(std::memory_order_relaxed); };
+
+private:
+    using Buffer = FixedBuffer<kLargeBuffer>;
+    using BufferPtr = std::unique_ptr<Buffer>;
+    using BufferVector = std::vector<BufferPtr>;
+
+    void threadFunc();
+
+    const std::string basename_;
+    const off_t rollSize_;
+    const int flushInterval_;
+    const size_t maxPendingBuffers_;
+
+    std::atomic_bool running_;
+    Thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    BufferPtr currentBuffer_;
+    BufferPtr nextBuffer_;
+    BufferVector buffers_;  // 写满等待后台线程写入的缓冲区
+    std::atomic<int64_t> droppedMessages_;
+};
@@ -1,11 +1,16 @@
 #include "Buffer.h"
+#include "SimdSearch.h"
 
 #include <errno.h>
 #include <sys/uio.h>
 #include <unistd.h>
 
 ssize_t Buffer::readFd(int fd, int* saveErrno) {
-    char extrabuf[65536] = {0};
+    char extrabuf[65536];   // 马上会被readv覆盖，无需清零
+    return readFd(fd, saveErrno, extrabuf, sizeof extrabuf);
+}
+
+ssize_t Buffer::readFd(int fd, int* saveErrno, char* extrabuf, size_t extrabufLen) {
     struct iovec vec[2];
 
     const size_t writable = writableBytes();
@@ -13,15 +18,15 @@ ssize_t Buffer::readFd(int fd, int* saveErrno) {
     vec[0].iov_len = writable;
 
     vec[1].iov_base = extrabuf;
-    vec[1].iov_len = sizeof extrabuf;
+    vec[1].iov_len = extrabufLen;
 
-    const int iovcnt = (writable < sizeof extrabuf) ? 2: 1;
+    const int iovcnt = (writable < extrabufLen) ? 2: 1;
     /*本节的关键函数 readv，即分散读，将零散内存块的数据读取到一处*/
     const ssize_t n = ::readv(fd, vec, iovcnt);
     if (n < 0) {
         *saveErrno = errno;
     }
-    else if (n <= writable) {   // Buffer的可写缓冲区足以存储读出来的数据
+    else if (static_cast<size_t>(n) <= writable) {   // Buffer的可写缓冲区足以存储读出来的数据
         writerIndex_ += n;
     }
     else {  // extrabuf中也写入了数据
@@ -37,4 +42,24 @@ ssize_t Buffer::writeFd(int fd, int* saveErrno) {
         *saveErrno = errno;
     }
     return n;
-}
\ No newline at end of file
+}
+
+const char* Buffer::findCRLF() const {
+    return SimdSearch::findCRLF(peek(), beginWrite());
+}
+
+const char* Buffer::findCRLF(const char* start) const {
+    return SimdSearch::findCRLF(start, beginWrite());
+}
+
+const char* Buffer::findEOL() const {
+    return SimdSearch::findByte(peek(), beginWrite(), '\n');
+}
+
+const char* Buffer::findEOL(const char* start) const {
+    return SimdSearch::findByte(start, beginWrite(), '\n');
+}
+
+const char* Buffer::findByte(char c) const {
+    return SimdSearch::findByte(peek(), beginWrite(), c);
+}
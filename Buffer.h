@@ -2,6 +2,13 @@
 
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <endian.h>
+
+#include "StringPiece.h"
 
 /// A buffer class modeled after org.jboss.netty.buffer.ChannelBuffer
 ///
@@ -20,7 +27,7 @@ public:
     static const size_t kInitialSize = 1024;
 
     explicit Buffer(size_t initialSize = kInitialSize)
-        : buffer_(kCheapPrepend + kInitialSize)
+        : buffer_(kCheapPrepend + initialSize)
         , readerIndex_(kCheapPrepend)
         , writerIndex_(kCheapPrepend) {
 
@@ -70,6 +77,68 @@ public:
         return result;
     }
 
+    // 返回可读数据前len个字节的视图，不拷贝也不移动读指针
+    // 视图在下一次retrieve / append之前有效，用完后由调用方显式retrieve
+    StringPiece peekView(size_t len) const {
+        return StringPiece(peek(), std::min(len, readableBytes()));
+    }
+
+    StringPiece peekAllView() const {
+        return StringPiece(peek(), readableBytes());
+    }
+
+    // 读指针移动到end处，end一般是findCRLF等查找函数的返回值
+    void retrieveUntil(const char* end) {
+        retrieve(end - peek());
+    }
+
+    // 以下为网络字节序(大端)的整数读写，调用方需保证可读数据足够
+    int64_t peekInt64() const {
+        int64_t be64 = 0;
+        ::memcpy(&be64, peek(), sizeof be64);
+        return static_cast<int64_t>(be64toh(be64));
+    }
+
+    int32_t peekInt32() const {
+        int32_t be32 = 0;
+        ::memcpy(&be32, peek(), sizeof be32);
+        return static_cast<int32_t>(be32toh(be32));
+    }
+
+    int16_t peekInt16() const {
+        int16_t be16 = 0;
+        ::memcpy(&be16, peek(), sizeof be16);
+        return static_cast<int16_t>(be16toh(be16));
+    }
+
+    int8_t peekInt8() const {
+        return static_cast<int8_t>(*peek());
+    }
+
+    int64_t readInt64() {
+        int64_t result = peekInt64();
+        retrieve(sizeof result);
+        return result;
+    }
+
+    int32_t readInt32() {
+        int32_t result = peekInt32();
+        retrieve(sizeof result);
+        return result;
+    }
+
+    int16_t readInt16() {
+        int16_t result = peekInt16();
+        retrieve(sizeof result);
+        return result;
+    }
+
+    int8_t readInt8() {
+        int8_t result = peekInt8();
+        retrieve(sizeof result);
+        return result;
+    }
+
     void ensureWritableBytes(size_t len) {
         if (writableBytes() < len) {
             makeSpace(len);
@@ -83,6 +152,61 @@ public:
         writerIndex_ += len;
     }
 
+    // 在可读区间【peek()，beginWrite()）中查找分隔符，找不到返回nullptr
+    // 直接在缓冲区上查找，不需要先把数据拷贝成string
+    const char* findCRLF() const;
+    const char* findCRLF(const char* start) const;  // 从start处开始查找
+    const char* findEOL() const;    // 查找'\n'
+    const char* findEOL(const char* start) const;
+    const char* findByte(char c) const;
+
+    void appendInt64(int64_t x) {
+        int64_t be64 = static_cast<int64_t>(htobe64(static_cast<uint64_t>(x)));
+        append(reinterpret_cast<const char*>(&be64), sizeof be64);
+    }
+
+    void appendInt32(int32_t x) {
+        int32_t be32 = static_cast<int32_t>(htobe32(static_cast<uint32_t>(x)));
+        append(reinterpret_cast<const char*>(&be32), sizeof be32);
+    }
+
+    void appendInt16(int16_t x) {
+        int16_t be16 = static_cast<int16_t>(htobe16(static_cast<uint16_t>(x)));
+        append(reinterpret_cast<const char*>(&be16), sizeof be16);
+    }
+
+    void appendInt8(int8_t x) {
+        append(reinterpret_cast<const char*>(&x), sizeof x);
+    }
+
+    // 把数据写到可读数据的前面，使用的是kCheapPrepend预留的空间，
+    // 适合在消息体写好之后再补上长度头
+    void prepend(const void* data, size_t len) {
+        assert(len <= prependableBytes());
+        readerIndex_ -= len;
+        const char* d = static_cast<const char*>(data);
+        std::copy(d, d + len, begin() + readerIndex_);
+    }
+
+    void prependInt64(int64_t x) {
+        int64_t be64 = static_cast<int64_t>(htobe64(static_cast<uint64_t>(x)));
+        prepend(&be64, sizeof be64);
+    }
+
+    void prependInt32(int32_t x) {
+        int32_t be32 = static_cast<int32_t>(htobe32(static_cast<uint32_t>(x)));
+        prepend(&be32, sizeof be32);
+    }
+
+    void prependInt16(int16_t x) {
+        int16_t be16 = static_cast<int16_t>(htobe16(static_cast<uint16_t>(x)));
+        prepend(&be16, sizeof be16);
+    }
+
+    void prependInt8(int8_t x) {
+        prepend(&x, sizeof x);
+    }
+
     char* beginWrite() {
         return begin() + writerIndex_;
     }
@@ -91,24 +215,55 @@ public:
         return begin() + writerIndex_;
     }
 
+    // 与另一个Buffer交换内容，只交换指针，不拷贝数据
+    void swap(Buffer& rhs) {
+        buffer_.swap(rhs.buffer_);
+        std::swap(readerIndex_, rhs.readerIndex_);
+        std::swap(writerIndex_, rhs.writerIndex_);
+    }
+
+    // 底层存储的实际大小
+    size_t internalCapacity() const {
+        return buffer_.capacity();
+    }
+
+    // 把底层存储收缩到 可读数据 + reserve 的大小
+    void shrink(size_t reserve) {
+        Buffer other(readableBytes() + reserve);
+        other.append(peek(), readableBytes());
+        swap(other);
+    }
+
+    // 没有可读数据时释放底层存储，只保留prepend区，下一次写入时再按需分配
+    // 保留prepend区使得begin() + writerIndex_仍然指向存储的末尾，而不是对空指针做运算
+    void releaseStorage() {
+        if (readableBytes() == 0) {
+            std::vector<char>(kCheapPrepend).swap(buffer_);
+            readerIndex_ = writerIndex_ = kCheapPrepend;
+        }
+    }
+
     // 从fd上读取数据
     ssize_t readFd(int fd, int* saveErrno);
+    // 从fd上读取数据，Buffer放不下的部分先读到调用方提供的extrabuf中，extrabuf不需要清零
+    ssize_t readFd(int fd, int* saveErrno, char* extrabuf, size_t extrabufLen);
 
     ssize_t writeFd(int fd, int* saveErrno);
 
 private:
     char* begin() {
-        return &*buffer_.begin(); // 返回首元素的地址，也是数组的起始地址
+        return buffer_.data(); // 返回首元素的地址，也是数组的起始地址
     }
 
     const char* begin() const {
-        return &*buffer_.begin();
+        return buffer_.data();
     }
 
     void makeSpace(size_t len) {
         // 可读的 + 空闲的仍小于要读取的长度
         if (writableBytes() + prependableBytes() < len + kCheapPrepend) {
-            buffer_.resize(writerIndex_ + len);
+            // 存储被释放过时，至少恢复到初始大小，避免小消息反复扩容
+            buffer_.resize(std::max(writerIndex_ + len, kCheapPrepend + kInitialSize));
         }
         else {
             size_t readable = readableBytes();
@@ -2,16 +2,19 @@
 
 #include <memory>
 #include <functional>
+#include <string>
 
 class Buffer;
 class TcpConnection;
 class Timestamp;
 
 using TcpConnectionPtr = std::shared_ptr<TcpConnection>;
+using ZeroCopyPayload = std::shared_ptr<const std::string>;
 using ConnectionCallback = std::function<void (const TcpConnectionPtr&)>;
 using CloseCallback = std::function<void (const TcpConnectionPtr&)>; 
 using WriteCompleteCallback = std::function<void (const TcpConnectionPtr&)>;
 using MessageCallback = std::function<void (const TcpConnectionPtr&,
                                             Buffer*,
                                             Timestamp)>;
+using TimerCallback = std::function<void()>;
 using HighWaterMarkCallback = std::function<void (const TcpConnectionPtr&, size_t)>;
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include "ChainBuffer.h"
+#include "CurrentThread.h"
+
+#include <errno.h>
+#include <algorithm>
+#include <sys/uio.h>
+
+BufferBlockPool::BufferBlockPool()
+    : ownerTid_(CurrentThread::tid())
+    , lowWaterMark_(0) {
+
+}
+
+BufferBlockPool::~BufferBlockPool() {
+
+}
+
+BufferBlockPool::BlockPtr BufferBlockPool::take() {
+    if (freeList_.empty() || CurrentThread::tid() != ownerTid_) {
+        return BlockPtr(new Buffer(kBlockSize));
+    }
+    BlockPtr block(std::move(freeList_.back()));
+    freeList_.pop_back();
+    lowWaterMark_ = std::min(lowWaterMark_, freeList_.size());
+    return block;
+}
+
+void BufferBlockPool::give(BlockPtr block) {
+    // 连接可能在其他线程析构，此时不能碰freeList_，直接释放即可
+    if (CurrentThread::tid() != ownerTid_
+        || freeList_.size() >= kMaxFreeBlocks
+        || block->internalCapacity() != Buffer::kCheapPrepend + kBlockSize) {
+        return;
+    }
+    block->retrieveAll();
+    freeList_.push_back(std::move(block));
+}
+
+void BufferBlockPool::trim() {
+    // 这些块在整个周期内都没有被取走过，说明当前负载用不到它们
+    freeList_.resize(freeList_.size() - lowWaterMark_);
+    lowWaterMark_ = freeList_.size();
+}
+
+ChainBuffer::ChainBuffer(BufferBlockPool* pool)
+    : pool_(pool)
+    , readableBytes_(0)
+    , capacity_(0)
+    , totalRetrieved_(0) {
+
+}
+
+ChainBuffer::~ChainBuffer() {
+    retrieveAll();
+}
+
+void ChainBuffer::append(const char* data, size_t len) {
+    readableBytes_ += len;
+    while (len > 0) {
+        if (blocks_.empty() || blocks_.back()->writableBytes() == 0) {
+            blocks_.push_back(pool_->take());
+            capacity_ += blocks_.back()->internalCapacity();
+        }
+        Buffer* tail = blocks_.back().get();
+        size_t n = std::min(len, tail->writableBytes());
+        tail->append(data, n);  // n不超过可写空间，不会触发makeSpace
+        data += n;
+        len -= n;
+    }
+}
+
+void ChainBuffer::appendBuffer(Buffer* buf) {
+    if (buf->readableBytes() == 0) {
+        return;
+    }
+    BufferBlockPool::BlockPtr block(pool_->take());
+    block->swap(*buf);
+    readableBytes_ += block->readableBytes();
+    capacity_ += block->internalCapacity();
+    blocks_.push_back(std::move(block));
+}
+
+void ChainBuffer::retrieve(size_t len) {
+    if (len >= readableBytes_) {
+        retrieveAll();
+        return;
+    }
+    readableBytes_ -= len;
+    totalRetrieved_ += len;
+    while (len > 0) {
+        Buffer* head = blocks_.front().get();
+        size_t n = head->readableBytes();
+        if (len < n) {
+            head->retrieve(len);
+            break;
+        }
+        len -= n;
+        capacity_ -= head->internalCapacity();
+        pool_->give(std::move(blocks_.front()));
+        blocks_.pop_front();
+    }
+}
+
+void ChainBuffer::retrieveAll() {
+    for (auto& block : blocks_) {
+        pool_->give(std::move(block));
+    }
+    blocks_.clear();
+    totalRetrieved_ += readableBytes_;
+    readableBytes_ = 0;
+    capacity_ = 0;
+}
+
+ssize_t ChainBuffer::writeFd(int fd, int* saveErrno, size_t maxBytes) {
+    ssize_t total = 0;
+    while (readableBytes_ > 0 && static_cast<size_t>(total) < maxBytes) {
+        struct iovec vec[kMaxIovecs];
+        int iovcnt = 0;
+        size_t expected = 0;
+        size_t limit = maxBytes - total;
+        for (auto it = blocks_.begin(); it != blocks_.end() && iovcnt < kMaxIovecs && expected < limit; ++it) {
+            Buffer* block = it->get();
+            if (block->readableBytes() == 0) {
+                continue;
+            }
+            vec[iovcnt].iov_base = const_cast<char*>(block->peek());
+            vec[iovcnt].iov_len = std::min(block->readableBytes(), limit - expected);
+            expected += vec[iovcnt].iov_len;
+            ++iovcnt;
+        }
+
+        ssize_t n = ::writev(fd, vec, iovcnt);
+        if (n < 0) {
+            *saveErrno = errno;
+            return total > 0 ? total : n;
+        }
+        retrieve(n);
+        total += n;
+        // 没有写完本批数据，说明内核发送缓冲区已满，再写只会得到EAGAIN
+        if (static_cast<size_t>(n) < expected) {
+            *saveErrno = EAGAIN;
+            break;
+        }
+    }
+    return total;
+}
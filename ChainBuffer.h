@@ -0,0 +1,82 @@
+#pragma once
+
+#include "nocopyable.h"
+#include "Buffer.h"
+
+#include <deque>
+#include <memory>
+#include <vector>
+#include <sys/types.h>
+#include <stdint.h>
+
+// 固定大小Buffer块的对象池，由EventLoop持有，只在所属loop线程中存取
+class BufferBlockPool : nocopyable {
+public:
+    using BlockPtr = std::unique_ptr<Buffer>;
+
+    static const size_t kBlockSize = 16 * 1024;
+    static const size_t kMaxFreeBlocks = 256;
+
+    BufferBlockPool();
+    ~BufferBlockPool();
+
+    // 取一个空块，池中没有时新建
+    BlockPtr take();
+    // 归还一个块，非标准大小的块或者池已满时直接释放
+    void give(BlockPtr block);
+
+    size_t freeBlocks() const { return freeList_.size(); };
+
+    // 释放自上次trim以来一直闲置的块，由loop周期性调用
+    void trim();
+
+private:
+    const pid_t ownerTid_;  // 创建池的线程，即所属的loop线程
+    std::vector<BlockPtr> freeList_;
+    size_t lowWaterMark_;   // 自上次trim以来freeList_的最小长度
+};
+
+/// 链式发送缓冲区，由若干个固定大小的Buffer块组成
+///
+/// @code
+/// +---------+    +---------+    +---------+
+/// | block 0 | -> | block 1 | -> | block 2 |
+/// +---------+    +---------+    +---------+
+///  peek...                        ...beginWrite
+/// @endcode
+///
+/// append只往链尾的块写，写满就从池里再取一块，已经排队的数据不会被移动；
+/// writeFd使用writev一次把多个块写到fd上
+class ChainBuffer : nocopyable {
+public:
+    explicit ChainBuffer(BufferBlockPool* pool);
+    ~ChainBuffer();
+
+    size_t readableBytes() const { return readableBytes_; };
+    // 链上所有块占用的存储大小，数据发完后块都会还给池，此时为0
+    size_t internalCapacity() const { return capacity_; };
+    // 累计被retrieve的字节数，可以用来标记链上的某个位置
+    uint64_t totalRetrieved() const { return totalRetrieved_; };
+
+    // 把【data，data + len】上的数据追加到链尾
+    void append(const char* data, size_t len);
+
+    // 把buf整个挂到链尾，只交换存储，不拷贝数据；buf换回一个池中的空块
+    void appendBuffer(Buffer* buf);
+
+    void retrieve(size_t len);
+    void retrieveAll();
+
+    // 循环writev，直到数据全部写完或者fd不可写(EAGAIN)，已写出的数据会被retrieve
+    // 最多写出maxBytes字节；返回写出的总字节数，一个字节都没写出且出错时返回-1
+    ssize_t writeFd(int fd, int* saveErrno, size_t maxBytes = SIZE_MAX);
+
+private:
+    static const int kMaxIovecs = 64;   // 一次writev最多携带的块数
+
+    BufferBlockPool* pool_;
+    std::deque<BufferBlockPool::BlockPtr> blocks_;
+    size_t readableBytes_;
+    size_t capacity_;
+    uint64_t totalRetrieved_;
+};
@@ -12,7 +12,7 @@
     , fd_(fd)
     , events_(0)
     , revents_(0)
-    , index_(-1)
+    , edgeTriggered_(false)
     , tied_(false){
 
 }
@@ -42,19 +42,21 @@ void Channel::remove() {
 
 void Channel::handlEvent(Timestamp receiveTime) {
     if (tied_) {
+        // 绑定的对象(TcpConnection)已经析构时不再处理事件
         std::shared_ptr<void> guard = tie_.lock();
         if (guard) {
             handleEventWithGuard(receiveTime);
         }
-        else {
-            handleEventWithGuard(receiveTime);
-        }
+    }
+    else {
+        // wakeupChannel、acceptChannel等没有绑定对象的channel
+        handleEventWithGuard(receiveTime);
     }
 }
 
 // 根据poller通知channel发生的具体事件，由channel负责调用具体的回调操作
 void Channel::handleEventWithGuard(Timestamp receiveTime) {
-    LOG_INFO("channel handleEvent revents:%d\n", revents_);
+    LOG_TRACE("channel handleEvent revents:%d\n", revents_);
 
     // EPOLLHUP：表示对应的文件描述符被挂断
     if ((revents_ & EPOLLHUP) && !(revents_ & EPOLLIN)) {
@@ -63,6 +65,7 @@ void Channel::handleEventWithGuard(Timestamp receiveTime) {
         }
     }
 
+    // socket出错，或者错误队列中有MSG_ZEROCOPY的完成通知
     if (revents_ & EPOLLERR) {
         if (errorCallback_) {
             errorCallback_();
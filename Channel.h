@@ -54,8 +54,9 @@ public:
     bool isReading() const { return events_ & kReadEvent; };
     bool isWriting() const { return events_ & kWriteEvent; };
 
-    int index() { return index_; };
-    void set_index(int idx) { index_ = idx; }; 
+    // 边沿触发（EPOLLET），需要在注册到poller之前设置；开启后回调必须读写到EAGAIN
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; };
+    bool edgeTriggered() const { return edgeTriggered_; };
 
     // one loop per thread
     EventLoop* onwerLoop() { return loop_; };
@@ -73,7 +74,7 @@ private:
     const int fd_;  // poller监听的对象 
     int events_;    // 注册fd感兴趣的事件
     int revents_;   // poller返回的实际发生的事件
-    int index_;
+    bool edgeTriggered_;
 
     std::weak_ptr<void> tie_;   // 用于观察一个强智能指针
     bool tied_;
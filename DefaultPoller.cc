@@ -1,13 +1,20 @@
 #include "Poller.h"
 #include "EPollPoller.h"
+#include "IoUringPoller.h"
+#include "Logger.h"
 
 #include <stdlib.h>
 
-Poller* Poller::newDefaultPoller(EventLoop* loop) {
-    if (::getenv("MUDUO_USE_POLL")) {
-        return nullptr;
+Poller* Poller::newDefaultPoller(EventLoop* loop, Backend backend) {
+    if (backend == kDefault) {
+        backend = ::getenv("MUDUO_USE_IO_URING") ? kIoUring : kEpoll;
     }
-    else {
-        return new EPollPoller(loop);
+    if (backend == kIoUring) {
+        Poller* poller = IoUringPoller::create(loop);
+        if (poller != nullptr) {
+            return poller;
+        }
+        LOG_INFO("io_uring is not available, fall back to epoll \n");
     }
+    return new EPollPoller(loop);
 }
\ No newline at end of file
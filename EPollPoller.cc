@@ -5,11 +5,6 @@
 #include <errno.h>
 #include <strings.h>
 
-const int kNew = -1;    // channel未添加到poller中，channel的成员index_ = -1
-const int kAdded = 1;   // channel已添加到poller中
-const int kDeleted = 2; // channel已从poller中删除
-
-
 EPollPoller::EPollPoller(EventLoop* loop)
     : Poller(loop)
     , epollfd_(::epoll_create1(EPOLL_CLOEXEC))
@@ -24,23 +19,25 @@ EPollPoller::~EPollPoller() {
 }
 
 Timestamp EPollPoller::poll(int timeoutMs, ChannelList* activeChannels) {
-    // 实际上使用LOG_DUBUG输出日志更为合理
-    LOG_INFO("func=%s => fd total count:%lu \n", __FUNCTION__, channels_.size());
-    
+    // 低延迟模式下每秒会调用很多次，只在调试时输出
+    LOG_TRACE("func=%s => fd total count:%lu \n", __FUNCTION__, numChannels_);
+
+    applyChanges();
+
     // 有事件的socket数量
     int numEvents = ::epoll_wait(epollfd_, &*events_.begin(), static_cast<int>(events_.size()), timeoutMs);
     int saveErrno = errno;
     Timestamp now(Timestamp::now());
 
     if (numEvents > 0) {
-        LOG_INFO("%d events happened \n", numEvents);
+        LOG_TRACE("%d events happened \n", numEvents);
         fillActiveChannels(numEvents, activeChannels);
         if (numEvents == events_.size()) {
             events_.resize(events_.size() * 2);
         }
     }
     else if (numEvents == 0) {
-        LOG_DEBUG("%s timeout! \n", __FUNCTION__);
+        LOG_TRACE("%s timeout! \n", __FUNCTION__);
     }
     else {
         if (saveErrno != EINTR) {
@@ -53,71 +50,108 @@ Timestamp EPollPoller::poll(int timeoutMs, ChannelList* activeChannels) {
 }
 
 // channel->update => EventLoop->updateChannel
-/** 
- * EventLoop    =>  poller poll
- *   ChannelList
- *   Poller
- *      ChannelMap<fd, channel*>    
- * 
-*/
+// 只记录下这个fd的关注事件有变化，真正的epoll_ctl推迟到下一次epoll_wait之前，
+// 同一轮里开了又关的EPOLLOUT这样的来回切换就不需要任何系统调用
 void EPollPoller::updateChannel(Channel* channel) {
-    const int index = channel->index();
-    LOG_INFO("func=%s => fd=%d events=%d index=%d \n", __FUNCTION__, channel->fd(), channel->events(), channel->index());
-
-    if (index == kNew || index == kDeleted) {
-        if (index == kNew) {
-            int fd = channel->fd();
-            channels_[fd] = channel;
+    const int fd = channel->fd();
+    ChannelSlot* slot = &slotFor(fd);
+    if (slot->channel != channel) {
+        slot = &installChannel(channel);
+        if (pending_.size() < channels_.size()) {
+            PendingState empty;
+            empty.events = 0;
+            empty.dirty = false;
+            pending_.resize(channels_.size(), empty);
         }
-        channel->set_index(kAdded);
-        update(EPOLL_CTL_ADD, channel);
     }
-    else {
-        int fd = channel->fd();
-        if (channel->isNoneEvent()) {
-            update(EPOLL_CTL_DEL, channel);
-            channel->set_index(kDeleted);
-        }
-        else {
-            update(EPOLL_CTL_MOD, channel);
-        }
+    LOG_TRACE("func=%s => fd=%d events=%d state=%d \n", __FUNCTION__, fd, channel->events(), slot->state);
+
+    if (!pending_[fd].dirty) {
+        pending_[fd].dirty = true;
+        changes_.push_back(fd);
     }
 }
 
 // channel->remove => EventLoop->removeChannel
+// fd随后可能被关闭并复用，所以删除立即生效，不进入changelist
 void EPollPoller::removeChannel(Channel* channel) {
-    int fd = channel->fd();
-    channels_.erase(fd);
+    const int fd = channel->fd();
+    LOG_TRACE("func=%s => fd=%d \n", __FUNCTION__, fd);
 
-    LOG_INFO("func=%s => fd=%d \n", __FUNCTION__, channel->fd());
+    const ChannelSlot* slot = findSlot(fd);
+    if (slot == nullptr || slot->channel != channel) {
+        return;
+    }
+    if (slot->state == kAdded) {
+        update(EPOLL_CTL_DEL, fd, 0, slot->generation);
+    }
+    pending_[fd].dirty = false;     // changes_中残留的fd在apply时会被跳过
+    uninstallChannel(channel);
+}
+
+// 把changelist中每个fd最终的关注事件和内核中的对比，只提交有差异的部分
+void EPollPoller::applyChanges() {
+    for (int fd : changes_) {
+        PendingState& pending = pending_[fd];
+        if (!pending.dirty) {
+            continue;
+        }
+        pending.dirty = false;
+
+        ChannelSlot& slot = channels_[fd];
+        Channel* channel = slot.channel;
+        uint32_t events = 0;
+        if (!channel->isNoneEvent()) {
+            events = static_cast<uint32_t>(channel->events());
+            if (channel->edgeTriggered()) {
+                events |= EPOLLET;
+            }
+        }
 
-    int index = channel->index();
-    if (index == kAdded) {
-        update(EPOLL_CTL_DEL, channel);
+        if (slot.state != kAdded) {
+            if (events != 0) {
+                update(EPOLL_CTL_ADD, fd, events, slot.generation);
+                slot.state = kAdded;
+                pending.events = events;
+            }
+        }
+        else if (events == 0) {
+            update(EPOLL_CTL_DEL, fd, 0, slot.generation);
+            slot.state = kDeleted;
+        }
+        else if (events != pending.events) {
+            update(EPOLL_CTL_MOD, fd, events, slot.generation);
+            pending.events = events;
+        }
     }
-    channel->set_index(kNew);
+    changes_.clear();
 }
 
 // 填写活跃的连接
 void EPollPoller::fillActiveChannels(int numEvents, ChannelList* activeChannels) const {
     for (int i = 0; i < numEvents; ++i) {
-        Channel* channel = static_cast<Channel*>(events_[i].data.ptr);
+        // data中保存的是fd和注册时的generation，fd已经换了channel的事件直接丢弃
+        int fd = static_cast<int>(static_cast<uint32_t>(events_[i].data.u64));
+        uint32_t generation = static_cast<uint32_t>(events_[i].data.u64 >> 32);
+        const ChannelSlot* slot = findSlot(fd);
+        if (slot == nullptr || slot->channel == nullptr || slot->generation != generation) {
+            continue;
+        }
+        Channel* channel = slot->channel;
         channel->set_revents(events_[i].events); // 设置活跃事件
         activeChannels->push_back(channel); // EventLoop在此处拿到了poller返回的所有发生事件的channel列表
     }
 }
 
 // 更新channel
-void EPollPoller::update(int operation, Channel* channel) {
+void EPollPoller::update(int operation, int fd, uint32_t events, uint32_t generation) {
     epoll_event event;
     bzero(&event, sizeof event);
 
-    int fd = channel->fd();
-
-    event.events = channel->events();
-    event.data.fd = channel->fd();
-    event.data.ptr = channel;
+    event.events = events;
+    event.data.u64 = (static_cast<uint64_t>(generation) << 32) | static_cast<uint32_t>(fd);
 
+    ctlCalls_.fetch_add(1, std::memory_order_relaxed);
     if (::epoll_ctl(epollfd_, operation, fd, &event) < 0) {
         if (operation == EPOLL_CTL_DEL) {
             LOG_ERROR("epoll_ctl del error:%d\n", errno);
@@ -28,11 +28,21 @@ private:
     
     // 填写活跃的连接
     void fillActiveChannels(int numEvents, ChannelList* avticeChannels) const;
-    // 更新channel
-    void update(int operation, Channel* channel);
+    // 提交changelist中积累的修改
+    void applyChanges();
+    // 调用epoll_ctl
+    void update(int operation, int fd, uint32_t events, uint32_t generation);
+
+    // 每个fd在内核中的关注事件，以及本轮是否有待提交的修改
+    struct PendingState {
+        uint32_t events;
+        bool dirty;
+    };
 
     using EventList = std::vector<epoll_event>;
 
     int epollfd_;
     EventList events_;  // 保存epoll_wait返回后就绪的文件描述符
+    std::vector<PendingState> pending_;     // 以fd为下标
+    std::vector<int> changes_;              // 本轮关注事件有变化的fd
 };
\ No newline at end of file
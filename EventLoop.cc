@@ -2,6 +2,10 @@
 #include "Logger.h"
 #include "Poller.h"
 #include "Channel.h"
+#include "ChainBuffer.h"
+#include "SlabArena.h"
+#include "TimerQueue.h"
+#include "TimingWheel.h"
 
 #include <sys/eventfd.h>
 #include <unistd.h>
@@ -16,6 +20,11 @@ __thread EventLoop* t_loopInThisThread = 0;
 // 定义默认的Poller IO复用接口的超时时间
 const int kPollTimeMs = 10000; 
 
+const size_t EventLoop::kRecvScratchSize;
+
+// 两次缓冲区回收之间的间隔
+const int kReclaimIntervalSec = 10;
+
 int createEventfd() {
     int evtfd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
     if (evtfd < 0) {
@@ -25,15 +34,27 @@ int createEventfd() {
 }
 
 
-EventLoop::EventLoop()
+EventLoop::EventLoop(Poller::Backend backend)
     : looping_(false)
     , quit_(false)
-    , callingPendingFunctors_(false)
     , threadId_(CurrentThread::tid())
-    , poller_(Poller::newDefaultPoller(this))
+    , poller_(Poller::newDefaultPoller(this, backend))
+    , timerQueue_(new TimerQueue(this))
     , wakeupFd_(createEventfd())
     , wakeupChannel_(new Channel(this, wakeupFd_))
-    , currentActiveChannel_(nullptr){
+    , blockPool_(new BufferBlockPool())
+    , arena_(std::make_shared<SlabArena>())
+    , recvScratch_(new char[kRecvScratchSize])   // 不做初始化，readv会直接覆盖
+    , nextReclaimId_(0)
+    , bufferBytes_(0)
+    , busyPollMicros_(0)
+    , socketBusyPollMicros_(0)
+    , spinMicros_(0)
+    , workMicros_(0)
+    , blockingPolls_(0)
+    , currentActiveChannel_(nullptr)
+    , callingPendingFunctors_(false)
+    , wakeupPending_(false) {
 
     LOG_DEBUG("EventLoop created %p in thread % d \n", this, threadId_);
     if (t_loopInThisThread) {
@@ -48,6 +69,9 @@ EventLoop::EventLoop()
     wakeupChannel_->setReadCallback(std::bind(&EventLoop::handleRead, this));
     // 每一个eventloop都将监听wakeupChannel的EPOLLIN读事件
     wakeupChannel_->enableReading();
+
+    // 周期性回收空闲连接的缓冲区
+    runEvery(kReclaimIntervalSec, std::bind(&EventLoop::doReclaim, this));
 }
 
 EventLoop::~EventLoop() {
@@ -67,12 +91,18 @@ void EventLoop::loop() {
     while (!quit_) {
         activeChannels_.clear();
         // 监听两类fd，一种是client的fd，另一种是wakeupfd
-        pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+        if (busyPollMicros_ > 0) {
+            pollReturnTime_ = busyPoll();
+        }
+        else {
+            pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+        }
 
         for (Channel* channel: activeChannels_) {
             // Poller负责监听哪些channel发生事件，上报给EventLoop，通知channel进行处理
             channel->handlEvent(pollReturnTime_);
         }
+        doAfterDispatchFunctors();
 
         // 执行当前EventLoop事件循环需要处理的回调操作
         /*
@@ -80,6 +110,19 @@ void EventLoop::loop() {
             当subloop被wakeup后，执行此前mainloop注册的若干cb操作
         */
         dePendingFunctors();
+        doAfterDispatchFunctors();
+        // 最后一轮写合并回调里产生的回调此时不在callingPendingFunctors_期间，queueInLoop不会唤醒，
+        // 不处理的话要等到poll超时才执行
+        if (!afterDispatchFunctors_.empty() || !pendingFunctors_.empty()) {
+            if (!wakeupPending_.exchange(true)) {
+                wakeup();
+            }
+        }
+
+        if (busyPollMicros_ > 0) {
+            workMicros_.fetch_add(microSecondsDifference(Timestamp::now(), pollReturnTime_),
+                                  std::memory_order_relaxed);
+        }
     }
     LOG_INFO("Eventloop %p stop looping! \n", this);
     looping_ = false;
@@ -98,7 +141,7 @@ void EventLoop::quit() {
 // 在当前loop中执行cb
 void EventLoop::runInLoop(Functor cb) {
     // 在当前的loop线程中执行callback
-    if (!isInLoopThread()) {
+    if (isInLoopThread()) {
         cb();
     }
     // 在非当前的loop线程中执行callback，需要唤醒对应线程，再执行cb
@@ -108,18 +151,33 @@ void EventLoop::runInLoop(Functor cb) {
 }
 // 把cb放入队列中，唤醒loop所在的线程，执行cb
 void EventLoop::queueInLoop(Functor cb) {
-    {
-        std::unique_lock<std::mutex> lock(mutex_);
-        pendingFunctors_.emplace_back(cb);
-    }
+    pendingFunctors_.push(std::move(cb));
     // 唤醒相应的需要执行上述回调操作的loop
     // || callingPendingFunctors_ = true: 当前loop正在执行回调，但是loop又有了新的回调
+    // 在loop取走回调之前只需要唤醒一次，后续的生产者看到wakeupPending_已置位就不再写eventfd
     if(!isInLoopThread() || callingPendingFunctors_) {
-        wakeup();
+        if (!wakeupPending_.exchange(true)) {
+            wakeup();
+        }
     }
 }
 
 
+void EventLoop::runAfterDispatch(Functor cb) {
+    afterDispatchFunctors_.push_back(std::move(cb));
+}
+
+void EventLoop::doAfterDispatchFunctors() {
+    if (afterDispatchFunctors_.empty()) {
+        return;
+    }
+    std::vector<Functor> functors;
+    functors.swap(afterDispatchFunctors_);
+    for (const Functor &functor : functors) {
+        functor();
+    }
+}
+
 // 用于唤醒subReactor
 void EventLoop::handleRead() {
     uint64_t one = 1;
@@ -139,6 +197,83 @@ void EventLoop::wakeup() {
      }
 }
 
+TimerId EventLoop::runAt(Timestamp time, TimerCallback cb) {
+    return timerQueue_->addTimer(std::move(cb), time, 0.0);
+}
+
+TimerId EventLoop::runAfter(double delay, TimerCallback cb) {
+    Timestamp time(addTime(Timestamp::now(), delay));
+    return runAt(time, std::move(cb));
+}
+
+TimerId EventLoop::runEvery(double interval, TimerCallback cb) {
+    Timestamp time(addTime(Timestamp::now(), interval));
+    return timerQueue_->addTimer(std::move(cb), time, interval);
+}
+
+void EventLoop::cancel(TimerId timerId) {
+    timerQueue_->cancel(timerId);
+}
+
+void EventLoop::setBusyPoll(int spinMicros, int socketBusyPollMicros) {
+    busyPollMicros_ = spinMicros;
+    socketBusyPollMicros_ = socketBusyPollMicros;
+}
+
+EventLoop::BusyPollStats EventLoop::busyPollStats() const {
+    BusyPollStats stats;
+    stats.spinMicros = spinMicros_.load(std::memory_order_relaxed);
+    stats.workMicros = workMicros_.load(std::memory_order_relaxed);
+    stats.blockingPolls = blockingPolls_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+// 跨线程投递回调时会写wakeupFd_，所以自旋期间也能及时发现新的回调
+Timestamp EventLoop::busyPoll() {
+    Timestamp start(Timestamp::now());
+    Timestamp now;
+    do {
+        now = poller_->poll(0, &activeChannels_);
+        if (!activeChannels_.empty()) {
+            spinMicros_.fetch_add(microSecondsDifference(now, start), std::memory_order_relaxed);
+            return now;
+        }
+    } while (!quit_ && microSecondsDifference(now, start) < busyPollMicros_);
+
+    spinMicros_.fetch_add(microSecondsDifference(now, start), std::memory_order_relaxed);
+    if (quit_) {
+        return now;
+    }
+    blockingPolls_.fetch_add(1, std::memory_order_relaxed);
+    return poller_->poll(kPollTimeMs, &activeChannels_);
+}
+
+TimingWheel* EventLoop::timingWheel() {
+    if (!timingWheel_) {
+        timingWheel_.reset(new TimingWheel());
+        runEvery(1.0, std::bind(&TimingWheel::tick, timingWheel_.get()));
+    }
+    return timingWheel_.get();
+}
+
+int64_t EventLoop::addReclaimCallback(ReclaimCallback cb) {
+    int64_t id = nextReclaimId_++;
+    reclaimCallbacks_[id] = std::move(cb);
+    return id;
+}
+
+void EventLoop::removeReclaimCallback(int64_t id) {
+    reclaimCallbacks_.erase(id);
+}
+
+// 依次让各个连接回收自己的缓冲区，再释放块池中闲置的块
+void EventLoop::doReclaim() {
+    for (auto& item : reclaimCallbacks_) {
+        item.second();
+    }
+    blockPool_->trim();
+}
+
 // Eventloop中 调用Poller的方法
 void EventLoop::updateChannel(Channel* channel) {
     poller_->updateChannel(channel);
@@ -154,16 +289,12 @@ bool EventLoop::hasChannel(Channel* channel) {
 
 // 执行回调 
 void EventLoop::dePendingFunctors() {
-    std::vector<Functor> functors;
     callingPendingFunctors_ = true; // 开始执行回调
-    {
-       std::unique_lock<std::mutex> lock(mutex_);
-       functors.swap(pendingFunctors_); 
-    }
-    
-    for (const Functor &functor : functors) {
+    // 先清除标志再取走回调：此后入队的生产者会重新唤醒loop，不会遗漏
+    wakeupPending_ = false;
+    pendingFunctors_.consumeAll([](Functor &functor) {
         functor();
-    }
+    });
 
     callingPendingFunctors_ = false;
 }
\ No newline at end of file
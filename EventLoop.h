@@ -4,21 +4,32 @@
 #include <vector>
 #include <atomic>
 #include <memory>
-#include <mutex>
+#include <unordered_map>
 
 #include "nocopyable.h"
 #include "Timestamp.h"
 #include "CurrentThread.h"
+#include "Callbacks.h"
+#include "TimerId.h"
+#include "MpscQueue.h"
+#include "Task.h"
+#include "Poller.h"
 
 class Channel;
-class Poller;
+class BufferBlockPool;
+class SlabArena;
+class TimerQueue;
+class TimingWheel;
 
 // 时间循环类 主要包含了两个大模块 Channel Poller（epoll）
 class EventLoop : nocopyable {
 public:
-    using Functor = std::function<void()>;
+    // 只能移动，小的回调直接存放在Task内部，不分配内存
+    using Functor = Task;
+    using ReclaimCallback = std::function<void()>;
     
-    EventLoop();
+    // backend选择IO复用的实现，见Poller::Backend
+    explicit EventLoop(Poller::Backend backend = Poller::kDefault);
     ~EventLoop();
 
     // 开启事件循环
@@ -26,6 +37,7 @@ public:
     // 退出事件循环
     void quit();
 
+    // 每轮循环缓存一次的时间，回调里需要"当前时间"时用它，不必再读时钟
     Timestamp pollReturnTime() const { return pollReturnTime_; };
 
     // 在当前loop中执行cb
@@ -33,6 +45,20 @@ public:
     // 把cb放入队列中，唤醒loop所在的线程，执行cb
     void queueInLoop(Functor cb);
 
+    // 在本轮事件分发（以及随后的pendingFunctors）结束后执行cb，只能在loop线程中调用
+    // 用于把一轮中多次产生的工作合并成一次，例如连接的写合并
+    void runAfterDispatch(Functor cb);
+
+    // 定时器，可以在任意线程调用，回调在loop线程中执行
+    // 在time时刻执行cb
+    TimerId runAt(Timestamp time, TimerCallback cb);
+    // delay秒之后执行cb
+    TimerId runAfter(double delay, TimerCallback cb);
+    // 每隔interval秒执行一次cb
+    TimerId runEvery(double interval, TimerCallback cb);
+    // 取消定时器
+    void cancel(TimerId timerId);
+
     // 用于唤醒loop所在的线程
     void wakeup();
 
@@ -41,6 +67,45 @@ public:
     void removeChannel(Channel* channel);
     bool hasChannel(Channel* channel);
 
+    // 本loop上所有连接共享的发送缓冲区块池
+    BufferBlockPool* blockPool() const { return blockPool_.get(); };
+
+    // 本loop上连接对象的内存分配器，连接通过std::allocate_shared从这里分配
+    const std::shared_ptr<SlabArena>& arena() const { return arena_; };
+
+    // 本loop上所有连接读数据时共用的临时接收区，只能在loop线程中使用
+    static const size_t kRecvScratchSize = 65536;
+    char* recvScratch() const { return recvScratch_.get(); };
+
+    // 本loop上用于空闲连接超时的时间轮，第一次使用时创建并开始每秒tick一次，只能在loop线程中调用
+    TimingWheel* timingWheel();
+
+    // 注册/注销缓冲区回收回调，loop大约每kReclaimIntervalSec秒调用一次，只能在loop线程中调用
+    int64_t addReclaimCallback(ReclaimCallback cb);
+    void removeReclaimCallback(int64_t id);
+
+    // 本loop上所有连接的缓冲区占用的字节数，可以在任意线程读取
+    int64_t bufferBytes() const { return bufferBytes_.load(std::memory_order_relaxed); };
+    void addBufferBytes(int64_t delta) { bufferBytes_.fetch_add(delta, std::memory_order_relaxed); };
+
+    // 低延迟模式：每次阻塞在poll之前，先以0超时轮询spinMicros微秒，0表示关闭
+    // socketBusyPollMicros > 0 时，本loop上新建的连接设置SO_BUSY_POLL/SO_PREFER_BUSY_POLL
+    // 需要在loop()开始前设置，例如在ThreadInitCallback中，见EventLoopThreadPool::setBusyPoll
+    void setBusyPoll(int spinMicros, int socketBusyPollMicros = 0);
+    int busyPollMicros() const { return busyPollMicros_; };
+    int socketBusyPollMicros() const { return socketBusyPollMicros_; };
+
+    // 低延迟模式下的时间统计，可以在任意线程读取
+    struct BusyPollStats {
+        int64_t spinMicros;     // 空转轮询没有拿到事件的时间
+        int64_t workMicros;     // 处理事件和回调的时间
+        int64_t blockingPolls;  // 自旋结束后转为阻塞poll的次数
+    };
+    BusyPollStats busyPollStats() const;
+
+    // poller向内核提交关注事件修改的次数，见Poller::ctlCalls
+    int64_t pollerCtlCalls() const { return poller_->ctlCalls(); };
+
     // 判断EventLoop对象是否在自己的线程里面
     bool isInLoopThread() const { return threadId_ == CurrentThread::tid(); };
 
@@ -48,6 +113,10 @@ private:
 
     void handleRead();
     void dePendingFunctors(); // 执行回调 
+    void doReclaim(); // 回收空闲连接的缓冲区
+    void doAfterDispatchFunctors();
+    // 先自旋轮询，超过busyPollMicros_仍没有事件再阻塞
+    Timestamp busyPoll();
 
     using ChannelList = std::vector<Channel*>;
 
@@ -56,16 +125,33 @@ private:
     const pid_t threadId_; // 记录当前线程的id 
     Timestamp pollReturnTime_; // poller返回发生事件的channels的时间点
     std::unique_ptr<Poller> poller_;
+    std::unique_ptr<TimerQueue> timerQueue_;
 
     int wakeupFd_; // 主要作用，当mainLoop获取一个新用户的channel，
                    // 通过轮询算法选择一个subloop，通过该成员唤醒subloop处理channel
     std::unique_ptr<Channel> wakeupChannel_;
+    std::unique_ptr<BufferBlockPool> blockPool_;
+    std::shared_ptr<SlabArena> arena_;   // 连接可能晚于loop释放，所以与连接共享所有权
+    std::unique_ptr<char[]> recvScratch_;
+    std::unique_ptr<TimingWheel> timingWheel_;
+
+    std::unordered_map<int64_t, ReclaimCallback> reclaimCallbacks_;
+    int64_t nextReclaimId_;
+    std::atomic<int64_t> bufferBytes_;
+
+    int busyPollMicros_;
+    int socketBusyPollMicros_;
+    std::atomic<int64_t> spinMicros_;
+    std::atomic<int64_t> workMicros_;
+    std::atomic<int64_t> blockingPolls_;
     
     ChannelList activeChannels_;
     Channel* currentActiveChannel_;
 
     std::atomic_bool callingPendingFunctors_; // 标识当前loop中是否又需要执行的回调操作
-    std::vector<Functor> pendingFunctors_; // 存储loop所有需要执行的回调操作
-    std::mutex mutex_; // 用于保护pendingFunctors_的线程安全
+    MpscQueue<Functor> pendingFunctors_; // 存储loop所有需要执行的回调操作，无锁入队
+    std::atomic_bool wakeupPending_; // 上次执行回调以来是否已经写过wakeupFd_
+
+    std::vector<Functor> afterDispatchFunctors_; // 只在loop线程中访问，无需加锁
 
 };
\ No newline at end of file
@@ -1,12 +1,13 @@
 #include "EventLoopThread.h"
 
-EventLoopThread::EventLoopThread(const ThreadInitCallback &cb , const std::string &name)
+EventLoopThread::EventLoopThread(const ThreadInitCallback &cb , const std::string &name, Poller::Backend backend)
         : loop_(nullptr)
         , exiting_(false)
         , thread_(std::bind(&EventLoopThread::threadFunc, this), name)
         , mutex_()
         , cond_()
-        , callback_(cb) {
+        , callback_(cb)
+        , backend_(backend) {
         
 }
 
@@ -34,7 +35,7 @@ EventLoop* EventLoopThread::startLoop() {
 
 // 该方法是在单独的新线程中运行
 void EventLoopThread::threadFunc() {
-    EventLoop loop; // one loop pre thread
+    EventLoop loop(backend_); // one loop pre thread
 
     if (callback_) {
         callback_(&loop);
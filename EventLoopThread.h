@@ -14,7 +14,8 @@ public:
     using ThreadInitCallback = std::function<void(EventLoop*)>;
 
     EventLoopThread(const ThreadInitCallback &cb = ThreadInitCallback()
-        , const std::string &name = std::string());
+        , const std::string &name = std::string()
+        , Poller::Backend backend = Poller::kDefault);
     ~EventLoopThread();
 
     EventLoop* startLoop();
@@ -28,4 +29,5 @@ private:
     std::mutex mutex_;
     std::condition_variable cond_;
     ThreadInitCallback callback_;
+    Poller::Backend backend_;
 };
\ No newline at end of file
@@ -1,12 +1,14 @@
 #include "EventLoopThreadPool.h"
 #include "EventLoopThread.h"
+#include "EventLoop.h"
 
 EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop, const std::string &nameArg) 
-    : baseLoop_(nullptr)
+    : baseLoop_(baseLoop)
     , name_{nameArg}
     , started_(false)
     , numThreads_(0)
-    , next_(0) {
+    , next_(0)
+    , backend_(Poller::kDefault) {
 
 }
 
@@ -14,13 +16,32 @@ EventLoopThreadPool::~EventLoopThreadPool() {
 
 }
 
+void EventLoopThreadPool::setBusyPoll(int index, int spinMicros, int socketBusyPollMicros) {
+    BusyPollConfig config;
+    config.spinMicros = spinMicros;
+    config.socketBusyPollMicros = socketBusyPollMicros;
+    busyPollConfigs_[index] = config;
+}
+
 void EventLoopThreadPool::start(const ThreadInitCallback &cb) {
     started_ = true;
 
     for (int i = 0; i < numThreads_; i++) {
         char buf[name_.size() + 32];
         snprintf(buf, sizeof buf, "%s%d", name_.c_str(), i);
-        EventLoopThread *t = new EventLoopThread(cb, buf);
+        ThreadInitCallback initCb = cb;
+        auto it = busyPollConfigs_.find(i);
+        if (it != busyPollConfigs_.end()) {
+            // 在loop线程中、loop()开始之前设置
+            BusyPollConfig config = it->second;
+            initCb = [config, cb](EventLoop* loop) {
+                loop->setBusyPoll(config.spinMicros, config.socketBusyPollMicros);
+                if (cb) {
+                    cb(loop);
+                }
+            };
+        }
+        EventLoopThread *t = new EventLoopThread(initCb, buf, backend_);
         threads_.push_back(std::unique_ptr<EventLoopThread>(t));
         loops_.push_back(t->startLoop());   // 底层创建线程，绑定一个新的EventLoop，并返回该loop的地址
     }
@@ -1,10 +1,12 @@
 #pragma once
 #include "nocopyable.h"
+#include "Poller.h"
 
 #include <functional>
 #include <string>
 #include <vector>
 #include <memory>
+#include <unordered_map>
 
 class EventLoop;
 class EventLoopThread;
@@ -17,6 +19,11 @@ public:
     ~EventLoopThreadPool();
 
     void setThreadNum(int numThreads) { numThreads_ = numThreads; };
+    // 让第index个subloop工作在低延迟模式，见EventLoop::setBusyPoll
+    // 只让绑定了独占CPU的loop自旋，需要在start之前调用
+    void setBusyPoll(int index, int spinMicros, int socketBusyPollMicros = 0);
+    // subloop使用的IO复用实现，需要在start之前调用
+    void setPollerBackend(Poller::Backend backend) { backend_ = backend; };
     void start(const ThreadInitCallback &cb = ThreadInitCallback());
 
     // 如果以Multi_loop模式工作，baseLoop_默认以轮询的方式分配channel给subloop
@@ -28,6 +35,10 @@ public:
     const std::string name() const { return name_; };
 
 private:
+    struct BusyPollConfig {
+        int spinMicros;
+        int socketBusyPollMicros;
+    };
 
     EventLoop *baseLoop_; 
     std::string name_;
@@ -36,4 +47,6 @@ private:
     int next_;
     std::vector<std::unique_ptr<EventLoopThread>> threads_;
     std::vector<EventLoop*> loops_;
+    std::unordered_map<int, BusyPollConfig> busyPollConfigs_;  // subloop下标 => 低延迟模式配置
+    Poller::Backend backend_;   // 所有subloop使用的poller后端
 };
\ No newline at end of file
@@ -0,0 +1,351 @@
+#include "IoUringPoller.h"
+#include "Logger.h"
+#include "Channel.h"
+
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+
+const unsigned IoUringPoller::kSqEntries;
+const unsigned IoUringPoller::kCqEntries;
+
+// 取消poll等内部请求的完成事件不对应任何channel
+static const uint64_t kInternalUserData = UINT64_MAX;
+
+static uint64_t makeUserData(int fd, uint32_t seq) {
+    return (static_cast<uint64_t>(seq) << 32) | static_cast<uint32_t>(fd);
+}
+
+IoUringPoller* IoUringPoller::create(EventLoop* loop) {
+    IoUringPoller* poller = new IoUringPoller(loop);
+    if (!poller->init()) {
+        delete poller;
+        return nullptr;
+    }
+    return poller;
+}
+
+IoUringPoller::IoUringPoller(EventLoop* loop)
+    : Poller(loop)
+    , ringFd_(-1)
+    , sqRing_(MAP_FAILED)
+    , sqRingSize_(0)
+    , sqHead_(nullptr)
+    , sqTail_(nullptr)
+    , sqMask_(0)
+    , sqEntries_(0)
+    , sqes_(nullptr)
+    , sqesSize_(0)
+    , sqLocalTail_(0)
+    , cqRing_(MAP_FAILED)
+    , cqRingSize_(0)
+    , cqHead_(nullptr)
+    , cqTail_(nullptr)
+    , cqMask_(0)
+    , cqes_(nullptr)
+    , nextSeq_(0)
+    , round_(0)
+    , multishotSupported_(true) {
+
+}
+
+IoUringPoller::~IoUringPoller() {
+    if (sqes_ != nullptr) {
+        ::munmap(sqes_, sqesSize_);
+    }
+    if (cqRing_ != MAP_FAILED && cqRing_ != sqRing_) {
+        ::munmap(cqRing_, cqRingSize_);
+    }
+    if (sqRing_ != MAP_FAILED) {
+        ::munmap(sqRing_, sqRingSize_);
+    }
+    if (ringFd_ >= 0) {
+        ::close(ringFd_);
+    }
+}
+
+bool IoUringPoller::init() {
+    io_uring_params params;
+    ::memset(&params, 0, sizeof params);
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = kCqEntries;
+
+    ringFd_ = static_cast<int>(::syscall(__NR_io_uring_setup, kSqEntries, &params));
+    if (ringFd_ < 0) {
+        LOG_ERROR("io_uring_setup error:%d \n", errno);
+        return false;
+    }
+    // 需要IORING_ENTER_EXT_ARG才能带超时等待(5.11+)
+    if (!(params.features & IORING_FEAT_EXT_ARG)) {
+        LOG_ERROR("io_uring lacks IORING_FEAT_EXT_ARG, features:%x \n", params.features);
+        return false;
+    }
+    ::fcntl(ringFd_, F_SETFD, FD_CLOEXEC);
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMmap) {
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+
+    sqRing_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED) {
+        LOG_ERROR("io_uring mmap sq ring error:%d \n", errno);
+        return false;
+    }
+    if (singleMmap) {
+        cqRing_ = sqRing_;
+    }
+    else {
+        cqRing_ = ::mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_CQ_RING);
+        if (cqRing_ == MAP_FAILED) {
+            LOG_ERROR("io_uring mmap cq ring error:%d \n", errno);
+            return false;
+        }
+    }
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = ::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        LOG_ERROR("io_uring mmap sqes error:%d \n", errno);
+        return false;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    char* sq = static_cast<char*>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqEntries_ = params.sq_entries;
+    sqLocalTail_ = *sqTail_;
+    // sqe数组和提交队列下标一一对应，之后不再改动
+    unsigned* array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    for (unsigned i = 0; i < sqEntries_; ++i) {
+        array[i] = i;
+    }
+
+    char* cq = static_cast<char*>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    LOG_INFO("IoUringPoller created, sq entries:%u cq entries:%u \n",
+             params.sq_entries, params.cq_entries);
+    return true;
+}
+
+int IoUringPoller::enter(unsigned toSubmit, unsigned minComplete, unsigned flags, int timeoutMs) {
+    __kernel_timespec ts;
+    io_uring_getevents_arg arg;
+    ::memset(&arg, 0, sizeof arg);
+    if (timeoutMs >= 0) {
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000 * 1000;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+    flags |= IORING_ENTER_EXT_ARG;
+    int ret = static_cast<int>(::syscall(__NR_io_uring_enter, ringFd_, toSubmit, minComplete,
+                                         flags, &arg, sizeof arg));
+    return ret;
+}
+
+// 提交队列满时先把已经填好的sqe提交掉
+io_uring_sqe* IoUringPoller::getSqe() {
+    unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    if (sqLocalTail_ - head >= sqEntries_) {
+        __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+        if (enter(sqLocalTail_ - head, 0, 0, -1) < 0) {
+            LOG_ERROR("io_uring_enter submit error:%d \n", errno);
+        }
+    }
+    io_uring_sqe* sqe = &sqes_[sqLocalTail_ & sqMask_];
+    ::memset(sqe, 0, sizeof *sqe);
+    ++sqLocalTail_;
+    ctlCalls_.fetch_add(1, std::memory_order_relaxed);
+    return sqe;
+}
+
+// 按channel当前关注的事件挂上poll，每次使用新的序号
+void IoUringPoller::arm(int fd, Registration& reg) {
+    reg.seq = ++nextSeq_;
+    if (reg.seq == 0) {
+        reg.seq = ++nextSeq_;
+    }
+    io_uring_sqe* sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = reg.events & ~static_cast<uint32_t>(EPOLLET);
+    sqe->len = reg.multishot ? IORING_POLL_ADD_MULTI : 0;
+    sqe->user_data = makeUserData(fd, reg.seq);
+    reg.armed = true;
+}
+
+// 撤下仍然有效的poll；之后到达的属于旧序号的完成事件都会被丢弃
+void IoUringPoller::disarm(int fd, Registration& reg) {
+    if (reg.armed) {
+        io_uring_sqe* sqe = getSqe();
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->fd = -1;
+        sqe->addr = makeUserData(fd, reg.seq);
+        sqe->user_data = kInternalUserData;
+        reg.armed = false;
+    }
+    reg.seq = 0;
+}
+
+Timestamp IoUringPoller::poll(int timeoutMs, ChannelList* activeChannels) {
+    LOG_TRACE("func=%s => fd total count:%lu \n", __FUNCTION__, numChannels_);
+
+    // 上一轮触发过的单次poll重新挂上，和其他修改一起提交
+    for (int fd : rearmFds_) {
+        const ChannelSlot* slot = findSlot(fd);
+        Registration& reg = registrations_[fd];
+        if (slot->channel != nullptr && !reg.armed && reg.events != 0) {
+            arm(fd, reg);
+        }
+    }
+    rearmFds_.clear();
+
+    __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+
+    // 完成队列里已经有事件时不等待
+    unsigned minComplete = 1;
+    if (__atomic_load_n(cqTail_, __ATOMIC_ACQUIRE) != *cqHead_) {
+        minComplete = 0;
+    }
+    unsigned toSubmit = sqLocalTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    int ret = enter(toSubmit, minComplete, IORING_ENTER_GETEVENTS, timeoutMs);
+    int saveErrno = errno;
+    Timestamp now(Timestamp::now());
+
+    if (ret < 0 && saveErrno != ETIME && saveErrno != EINTR) {
+        errno = saveErrno;
+        LOG_ERROR("IoUringPoller::poll() err:%d \n", saveErrno);
+    }
+    reapCompletions(activeChannels);
+    return now;
+}
+
+void IoUringPoller::reapCompletions(ChannelList* activeChannels) {
+    ++round_;
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+        const io_uring_cqe& cqe = cqes_[head & cqMask_];
+        if (cqe.user_data == kInternalUserData) {
+            continue;
+        }
+        int fd = static_cast<int>(static_cast<uint32_t>(cqe.user_data));
+        uint32_t seq = static_cast<uint32_t>(cqe.user_data >> 32);
+        const ChannelSlot* slot = findSlot(fd);
+        if (slot == nullptr || slot->channel == nullptr || registrations_[fd].seq != seq) {
+            continue;   // 已经撤下或者fd已被复用，丢弃
+        }
+        Registration& reg = registrations_[fd];
+        uint32_t revents = static_cast<uint32_t>(cqe.res);
+        if (!(cqe.flags & IORING_CQE_F_MORE)) {
+            reg.armed = false;
+        }
+        if (cqe.res == -EINVAL && reg.multishot) {
+            // 内核不支持multishot poll，之后都用单次poll
+            if (multishotSupported_) {
+                LOG_INFO("io_uring rejects multishot poll, use one-shot poll instead \n");
+                multishotSupported_ = false;
+            }
+            reg.multishot = false;
+            rearmFds_.push_back(fd);
+            continue;
+        }
+        if (cqe.res < 0 && cqe.res != -ECANCELED) {
+            // 重挂同样会失败，不再重挂，由channel的错误回调处理；
+            // seq清零，之后updateChannel会重新挂上
+            LOG_ERROR("IoUringPoller poll fd:%d error:%d \n", fd, -cqe.res);
+            reg.armed = false;
+            reg.seq = 0;
+            revents = EPOLLERR;
+        }
+        else if (!reg.armed) {
+            // 单次poll触发后，或者multishot被内核取消，都需要重新挂上
+            rearmFds_.push_back(fd);
+        }
+        if (cqe.res == -ECANCELED) {
+            continue;
+        }
+        // multishot可能在同一轮产生多个完成事件，合并成一次回调
+        if (reg.round != round_) {
+            reg.round = round_;
+            reg.revents = 0;
+            readyFds_.push_back(fd);
+        }
+        reg.revents |= revents;
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+
+    for (int fd : readyFds_) {
+        Channel* channel = channels_[fd].channel;
+        channel->set_revents(static_cast<int>(registrations_[fd].revents));
+        activeChannels->push_back(channel);
+    }
+    readyFds_.clear();
+}
+
+void IoUringPoller::updateChannel(Channel* channel) {
+    const int fd = channel->fd();
+    ChannelSlot* slot = &slotFor(fd);
+    if (slot->channel != channel) {
+        slot = &installChannel(channel);
+        if (registrations_.size() < channels_.size()) {
+            Registration empty;
+            ::memset(&empty, 0, sizeof empty);
+            registrations_.resize(channels_.size(), empty);
+        }
+        ::memset(&registrations_[fd], 0, sizeof(Registration));
+    }
+    LOG_TRACE("func=%s => fd=%d events=%d state=%d \n", __FUNCTION__, fd, channel->events(), slot->state);
+
+    const int state = slot->state;
+    Registration& reg = registrations_[fd];
+    const uint32_t events = static_cast<uint32_t>(channel->events());
+    const bool multishot = channel->edgeTriggered() && multishotSupported_;
+
+    if (channel->isNoneEvent()) {
+        disarm(fd, reg);
+        reg.events = 0;
+        slot->state = kDeleted;
+        return;
+    }
+    if (state == kAdded && reg.events == events && reg.multishot == multishot
+            && (reg.armed || reg.seq != 0)) {
+        return; // 关注的事件没有变化，已经挂着的poll或者待重挂的fd继续有效
+    }
+    disarm(fd, reg);
+    reg.events = events;
+    reg.multishot = multishot;
+    arm(fd, reg);
+    slot->state = kAdded;
+}
+
+void IoUringPoller::removeChannel(Channel* channel) {
+    const int fd = channel->fd();
+    LOG_TRACE("func=%s => fd=%d \n", __FUNCTION__, fd);
+
+    const ChannelSlot* slot = findSlot(fd);
+    if (slot == nullptr || slot->channel != channel) {
+        return;
+    }
+    Registration& reg = registrations_[fd];
+    disarm(fd, reg);
+    reg.events = 0;
+    uninstallChannel(channel);
+}
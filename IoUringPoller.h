@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Poller.h"
+#include "Timestamp.h"
+
+#include <vector>
+#include <stdint.h>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/*
+    基于io_uring的Poller，直接使用系统调用，不依赖liburing
+    - channel的注册、修改、删除只是往提交队列里填sqe，在下一次poll时
+      和等待事件合并成一次io_uring_enter，一轮循环只有一次系统调用
+    - 水平触发的channel使用单次poll，触发后在下一轮提交时重新挂上，语义和epoll的LT一致
+    - 边沿触发的channel使用multishot poll，只要不取消就持续产生完成事件；
+      内核不支持multishot(5.13之前)时以-EINVAL拒绝，之后边沿触发的channel也改用单次poll，
+      事件按水平触发送达，边沿触发的回调本来就读写到EAGAIN，语义不受影响
+    - poll以ECANCELED以外的错误结束时不再重挂，给channel送一个EPOLLERR
+    - 每次挂poll都分配新的序号编码进user_data，取消或fd复用之后迟到的完成事件按序号丢弃
+    内核不支持io_uring或者缺少需要的特性时create返回nullptr，由newDefaultPoller退回epoll
+*/
+class IoUringPoller : public Poller {
+public:
+    static IoUringPoller* create(EventLoop* loop);
+    ~IoUringPoller() override;
+
+    Timestamp poll(int timeoutMs, ChannelList* activeChannels) override;
+    void updateChannel(Channel* channel) override;
+    void removeChannel(Channel* channel) override;
+
+private:
+    static const unsigned kSqEntries = 256;
+    static const unsigned kCqEntries = 4096;
+
+    // 每个注册的fd当前挂着的poll
+    struct Registration {
+        uint32_t seq;       // 当前poll的序号，0表示没有挂poll
+        uint32_t events;    // 关注的事件，0表示暂不关注
+        bool multishot;
+        bool armed;         // 内核中是否有这个fd仍然有效的poll请求
+        uint32_t round;     // 最近一次产生事件的轮次，用于合并同一轮的多个完成事件
+        uint32_t revents;
+    };
+
+    explicit IoUringPoller(EventLoop* loop);
+    bool init();
+
+    io_uring_sqe* getSqe();
+    int enter(unsigned toSubmit, unsigned minComplete, unsigned flags, int timeoutMs);
+    void arm(int fd, Registration& reg);
+    void disarm(int fd, Registration& reg);
+    void reapCompletions(ChannelList* activeChannels);
+
+    int ringFd_;
+
+    // 提交队列
+    void* sqRing_;
+    size_t sqRingSize_;
+    unsigned* sqHead_;
+    unsigned* sqTail_;
+    unsigned sqMask_;
+    unsigned sqEntries_;
+    io_uring_sqe* sqes_;
+    size_t sqesSize_;
+    unsigned sqLocalTail_;  // 已经填好的sqe的尾部，提交前才对内核发布
+
+    // 完成队列，可能和提交队列共用一块映射
+    void* cqRing_;
+    size_t cqRingSize_;
+    unsigned* cqHead_;
+    unsigned* cqTail_;
+    unsigned cqMask_;
+    io_uring_cqe* cqes_;
+
+    uint32_t nextSeq_;
+    uint32_t round_;
+    bool multishotSupported_;   // 收到multishot poll的-EINVAL之后置为false
+    std::vector<Registration> registrations_;   // 和channels_一样以fd为下标
+    std::vector<int> rearmFds_;     // 单次poll已经触发、需要在下次提交时重新挂上的fd
+    std::vector<int> readyFds_;
+};
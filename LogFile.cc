@@ -0,0 +1,112 @@
+#include "LogFile.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+LogFile::LogFile(const std::string &basename, off_t rollSize, int flushInterval)
+    : basename_(basename)
+    , rollSize_(rollSize)
+    , flushInterval_(flushInterval)
+    , fp_(nullptr)
+    , writtenBytes_(0)
+    , startOfPeriod_(0)
+    , lastRoll_(0)
+    , lastFlush_(0) {
+    rollFile();
+}
+
+LogFile::~LogFile() {
+    if (fp_) {
+        ::fclose(fp_);
+    }
+}
+
+// 后台线程每次交过来的是整块缓冲区，直接顺序写入，由stdio的缓冲合并成大块write
+void LogFile::append(const char* logline, size_t len) {
+    if (!fp_) {
+        return;
+    }
+
+    size_t written = 0;
+    while (written != len) {
+        size_t n = ::fwrite_unlocked(logline + written, 1, len - written, fp_);
+        if (n == 0) {
+            int err = ::ferror(fp_);
+            if (err) {
+                ::fprintf(stderr, "LogFile::append() failed %s\n", ::strerror(err));
+            }
+            break;
+        }
+        written += n;
+    }
+    writtenBytes_ += written;
+
+    time_t now = ::time(nullptr);
+    if (writtenBytes_ > rollSize_) {
+        rollFile();
+    }
+    else if (now / kRollPerSeconds * kRollPerSeconds != startOfPeriod_) {
+        rollFile();
+    }
+    else if (now - lastFlush_ > flushInterval_) {
+        lastFlush_ = now;
+        flush();
+    }
+}
+
+void LogFile::flush() {
+    if (fp_) {
+        ::fflush(fp_);
+    }
+}
+
+// 同一秒内不重复滚动，避免生成同名文件
+bool LogFile::rollFile() {
+    time_t now = ::time(nullptr);
+    if (now <= lastRoll_) {
+        return false;
+    }
+
+    std::string filename = getLogFileName(basename_, now);
+    FILE* fp = ::fopen(filename.c_str(), "ae");
+    if (!fp) {
+        ::fprintf(stderr, "LogFile::rollFile() open %s failed %s\n", filename.c_str(), ::strerror(errno));
+        return false;
+    }
+    if (fp_) {
+        ::fclose(fp_);
+    }
+    fp_ = fp;
+    ::setbuffer(fp_, fileBuffer_, sizeof fileBuffer_);
+
+    writtenBytes_ = 0;
+    lastRoll_ = now;
+    lastFlush_ = now;
+    startOfPeriod_ = now / kRollPerSeconds * kRollPerSeconds;
+    return true;
+}
+
+std::string LogFile::getLogFileName(const std::string &basename, time_t now) {
+    std::string filename(basename);
+
+    char timebuf[32];
+    struct tm tm;
+    ::gmtime_r(&now, &tm);
+    ::strftime(timebuf, sizeof timebuf, ".%Y%m%d-%H%M%S.", &tm);
+    filename += timebuf;
+
+    char hostname[256];
+    if (::gethostname(hostname, sizeof hostname) == 0) {
+        hostname[sizeof hostname - 1] = '\0';
+        filename += hostname;
+    }
+    else {
+        filename += "unknownhost";
+    }
+
+    char pidbuf[32];
+    snprintf(pidbuf, sizeof pidbuf, ".%d.log", ::getpid());
+    filename += pidbuf;
+    return filename;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdio.h>
+#include <time.h>
+#include <sys/types.h>
+#include <string>
+
+#include "nocopyable.h"
+
+/*
+    按大小和日期滚动的日志文件，只由AsyncLogging的后台线程写，不加锁
+    文件名：basename.20240101-120000.hostname.pid.log
+    - 写入量超过rollSize时滚动到新文件
+    - 跨过零点(UTC)后的第一次写入滚动到新文件
+    - 距上次flush超过flushInterval秒时flush一次
+*/
+class LogFile: nocopyable {
+public:
+    LogFile(const std::string &basename, off_t rollSize, int flushInterval = 3);
+    ~LogFile();
+
+    void append(const char* logline, size_t len);
+    void flush();
+    bool rollFile();
+
+private:
+    static std::string getLogFileName(const std::string &basename, time_t now);
+
+    static const int kRollPerSeconds = 60 * 60 * 24;
+
+    const std::string basename_;
+    const off_t rollSize_;
+    const int flushInterval_;
+
+    FILE* fp_;
+    off_t writtenBytes_;
+    time_t startOfPeriod_;  // 当前文件所属的那一天的零点
+    time_t lastRoll_;
+    time_t lastFlush_;
+    char fileBuffer_[64 * 1024];
+};
@@ -0,0 +1,404 @@
+#include "LogStream.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <type_traits>
+
+namespace {
+
+// 00~99每个数的两位字符，一次除以100转换两位
+const char kDigitPairs[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+const char kHexDigits[] = "0123456789abcdef";
+
+// 从后往前生成数字，再拷到buf，返回长度
+template<typename T>
+size_t convert(char buf[], T value) {
+    using U = typename std::make_unsigned<T>::type;
+    bool negative = value < 0;
+    U u = negative ? static_cast<U>(0) - static_cast<U>(value) : static_cast<U>(value);
+
+    char tmp[32];
+    char* end = tmp + sizeof tmp;
+    char* p = end;
+    while (u >= 100) {
+        unsigned idx = static_cast<unsigned>(u % 100) * 2;
+        u /= 100;
+        *--p = kDigitPairs[idx + 1];
+        *--p = kDigitPairs[idx];
+    }
+    if (u >= 10) {
+        unsigned idx = static_cast<unsigned>(u) * 2;
+        *--p = kDigitPairs[idx + 1];
+        *--p = kDigitPairs[idx];
+    }
+    else {
+        *--p = static_cast<char>('0' + u);
+    }
+    if (negative) {
+        *--p = '-';
+    }
+
+    size_t len = static_cast<size_t>(end - p);
+    memcpy(buf, p, len);
+    return len;
+}
+
+// printf的长度修饰符
+enum Length {
+    kNoLength,
+    kChar,      // hh
+    kShort,     // h
+    kLong,      // l
+    kLongLong,  // ll
+    kSize,      // z
+    kIntMax,    // j
+    kPtrDiff,   // t
+    kLongDouble,    // L
+};
+
+const char* parseLength(const char* p, Length* length) {
+    switch (*p) {
+        case 'h':
+            if (p[1] == 'h') {
+                *length = kChar;
+                return p + 2;
+            }
+            *length = kShort;
+            return p + 1;
+        case 'l':
+            if (p[1] == 'l') {
+                *length = kLongLong;
+                return p + 2;
+            }
+            *length = kLong;
+            return p + 1;
+        case 'z': *length = kSize; return p + 1;
+        case 'j': *length = kIntMax; return p + 1;
+        case 't': *length = kPtrDiff; return p + 1;
+        case 'L': *length = kLongDouble; return p + 1;
+        default: *length = kNoLength; return p;
+    }
+}
+
+size_t convertHex(char buf[], uintptr_t value) {
+    char tmp[32];
+    char* end = tmp + sizeof tmp;
+    char* p = end;
+    do {
+        *--p = kHexDigits[value & 0xf];
+        value >>= 4;
+    } while (value != 0);
+
+    size_t len = static_cast<size_t>(end - p);
+    memcpy(buf, p, len);
+    return len;
+}
+
+}
+
+template<typename T>
+void LogStream::formatInteger(T v) {
+    if (buffer_.avail() >= kMaxNumericSize) {
+        size_t len = convert(buffer_.current(), v);
+        buffer_.add(len);
+    }
+}
+
+LogStream& LogStream::operator<<(short v) {
+    *this << static_cast<int>(v);
+    return *this;
+}
+
+LogStream& LogStream::operator<<(unsigned short v) {
+    *this << static_cast<unsigned int>(v);
+    return *this;
+}
+
+LogStream& LogStream::operator<<(int v) {
+    formatInteger(v);
+    return *this;
+}
+
+LogStream& LogStream::operator<<(unsigned int v) {
+    formatInteger(v);
+    return *this;
+}
+
+LogStream& LogStream::operator<<(long v) {
+    formatInteger(v);
+    return *this;
+}
+
+LogStream& LogStream::operator<<(unsigned long v) {
+    formatInteger(v);
+    return *this;
+}
+
+LogStream& LogStream::operator<<(long long v) {
+    formatInteger(v);
+    return *this;
+}
+
+LogStream& LogStream::operator<<(unsigned long long v) {
+    formatInteger(v);
+    return *this;
+}
+
+LogStream& LogStream::operator<<(const void* p) {
+    if (buffer_.avail() >= kMaxNumericSize) {
+        char* buf = buffer_.current();
+        buf[0] = '0';
+        buf[1] = 'x';
+        size_t len = convertHex(buf + 2, reinterpret_cast<uintptr_t>(p));
+        buffer_.add(len + 2);
+    }
+    return *this;
+}
+
+// 整数值的double走整数转换，输出和%.12g一致；其他情况交给snprintf
+LogStream& LogStream::operator<<(double v) {
+    if (buffer_.avail() >= kMaxNumericSize) {
+        if (v == floor(v) && fabs(v) < 1e12) {
+            formatInteger(static_cast<long long>(v));
+        }
+        else {
+            int len = snprintf(buffer_.current(), kMaxNumericSize, "%.12g", v);
+            buffer_.add(len);
+        }
+    }
+    return *this;
+}
+
+void LogStream::appendClipped(const char* data, size_t len) {
+    size_t avail = buffer_.avail();
+    if (avail > 1) {
+        len = std::min(len, avail - 1);
+        memcpy(buffer_.current(), data, len);
+        buffer_.add(len);
+    }
+}
+
+template<typename T>
+void LogStream::formatSpec(const char* spec, const int* stars, int starCount, T value) {
+    size_t avail = buffer_.avail();
+    if (avail <= 1) {
+        return;
+    }
+    int n;
+    if (starCount == 0) {
+        n = snprintf(buffer_.current(), avail, spec, value);
+    }
+    else if (starCount == 1) {
+        n = snprintf(buffer_.current(), avail, spec, stars[0], value);
+    }
+    else {
+        n = snprintf(buffer_.current(), avail, spec, stars[0], stars[1], value);
+    }
+    if (n > 0) {
+        buffer_.add(std::min(static_cast<size_t>(n), avail - 1));
+    }
+}
+
+void LogStream::appendFormat(const char* fmt, va_list args) {
+    const char* p = fmt;
+    while (*p != '\0') {
+        if (*p != '%') {
+            const char* text = p;
+            while (*p != '\0' && *p != '%') {
+                ++p;
+            }
+            appendClipped(text, p - text);
+            continue;
+        }
+
+        // 解析一个转换：%[标志][宽度][.精度][长度]转换符
+        const char* specBegin = p++;
+        bool plain = true;  // 没有标志、宽度和精度
+        int stars[2];
+        int starCount = 0;
+        while (*p != '\0' && strchr("-+ #0'", *p) != nullptr) {
+            ++p;
+            plain = false;
+        }
+        if (*p == '*') {
+            stars[starCount++] = va_arg(args, int);
+            ++p;
+            plain = false;
+        }
+        while (*p >= '0' && *p <= '9') {
+            ++p;
+            plain = false;
+        }
+        if (*p == '.') {
+            ++p;
+            plain = false;
+            if (*p == '*') {
+                stars[starCount++] = va_arg(args, int);
+                ++p;
+            }
+            while (*p >= '0' && *p <= '9') {
+                ++p;
+            }
+        }
+        const char* lengthBegin = p;
+        Length length;
+        p = parseLength(p, &length);
+        const char conv = *p;
+        if (conv == '\0') {
+            break;  // 格式串末尾不完整的转换和vsnprintf一样不输出
+        }
+        ++p;
+
+        // 交给snprintf的格式：保留标志、宽度和精度，长度修饰符换成实际传入的类型
+        char spec[32];
+        size_t prefixLen = static_cast<size_t>(lengthBegin - specBegin);
+        if (prefixLen + 4 > sizeof spec) {
+            appendClipped(specBegin, p - specBegin);
+            continue;
+        }
+        memcpy(spec, specBegin, prefixLen);
+        char* specEnd = spec + prefixLen;
+
+        switch (conv) {
+            case 'd':
+            case 'i': {
+                long long v;
+                switch (length) {
+                    case kChar: v = static_cast<signed char>(va_arg(args, int)); break;
+                    case kShort: v = static_cast<short>(va_arg(args, int)); break;
+                    case kLong: v = va_arg(args, long); break;
+                    case kLongLong: v = va_arg(args, long long); break;
+                    case kSize: v = va_arg(args, ssize_t); break;
+                    case kIntMax: v = va_arg(args, intmax_t); break;
+                    case kPtrDiff: v = va_arg(args, ptrdiff_t); break;
+                    default: v = va_arg(args, int); break;
+                }
+                if (plain) {
+                    *this << v;
+                }
+                else {
+                    memcpy(specEnd, "lld", 4);
+                    formatSpec(spec, stars, starCount, v);
+                }
+                break;
+            }
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o': {
+                unsigned long long v;
+                switch (length) {
+                    case kChar: v = static_cast<unsigned char>(va_arg(args, unsigned int)); break;
+                    case kShort: v = static_cast<unsigned short>(va_arg(args, unsigned int)); break;
+                    case kLong: v = va_arg(args, unsigned long); break;
+                    case kLongLong: v = va_arg(args, unsigned long long); break;
+                    case kSize: v = va_arg(args, size_t); break;
+                    case kIntMax: v = va_arg(args, uintmax_t); break;
+                    case kPtrDiff: v = static_cast<unsigned long long>(va_arg(args, ptrdiff_t)); break;
+                    default: v = va_arg(args, unsigned int); break;
+                }
+                if (plain && conv == 'u') {
+                    *this << v;
+                }
+                else {
+                    specEnd[0] = 'l';
+                    specEnd[1] = 'l';
+                    specEnd[2] = conv;
+                    specEnd[3] = '\0';
+                    formatSpec(spec, stars, starCount, v);
+                }
+                break;
+            }
+            case 's': {
+                if (length == kLong) {
+                    memcpy(specEnd, "ls", 3);
+                    formatSpec(spec, stars, starCount, va_arg(args, const wchar_t*));
+                    break;
+                }
+                const char* str = va_arg(args, const char*);
+                if (plain) {
+                    // 和glibc一样，空指针输出(null)
+                    str = str != nullptr ? str : "(null)";
+                    appendClipped(str, strlen(str));
+                }
+                else {
+                    memcpy(specEnd, "s", 2);
+                    formatSpec(spec, stars, starCount, str);
+                }
+                break;
+            }
+            case 'c': {
+                int c = va_arg(args, int);
+                if (plain && length == kNoLength) {
+                    *this << static_cast<char>(c);
+                }
+                else {
+                    specEnd[0] = length == kLong ? 'l' : 'c';
+                    specEnd[1] = length == kLong ? 'c' : '\0';
+                    specEnd[2] = '\0';
+                    formatSpec(spec, stars, starCount, c);
+                }
+                break;
+            }
+            case 'p': {
+                const void* ptr = va_arg(args, const void*);
+                if (plain) {
+                    // 和glibc一样，空指针输出(nil)
+                    if (ptr == nullptr) {
+                        appendClipped("(nil)", 5);
+                    }
+                    else {
+                        *this << ptr;
+                    }
+                }
+                else {
+                    memcpy(specEnd, "p", 2);
+                    formatSpec(spec, stars, starCount, ptr);
+                }
+                break;
+            }
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+                // 浮点数的舍入规则和%.12g不同，统一交给snprintf
+                if (length == kLongDouble) {
+                    specEnd[0] = 'L';
+                    specEnd[1] = conv;
+                    specEnd[2] = '\0';
+                    formatSpec(spec, stars, starCount, va_arg(args, long double));
+                }
+                else {
+                    specEnd[0] = conv;
+                    specEnd[1] = '\0';
+                    formatSpec(spec, stars, starCount, va_arg(args, double));
+                }
+                break;
+            case '%':
+                appendClipped("%", 1);
+                break;
+            case 'n':
+                // 日志里不支持回写已输出的字符数，只跳过参数
+                va_arg(args, void*);
+                break;
+            default:
+                // 不认识的转换符原样输出
+                appendClipped(specBegin, p - specBegin);
+                break;
+        }
+    }
+}
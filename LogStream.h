@@ -0,0 +1,124 @@
+#pragma once
+
+#include <stdarg.h>
+#include <string.h>
+#include <string>
+
+#include "nocopyable.h"
+#include "StringPiece.h"
+
+const int kSmallBuffer = 4000;
+const int kLargeBuffer = 4000 * 1000;
+
+// 定长缓冲区，空间不够时丢弃新追加的内容，不会重新分配
+template<int SIZE>
+class FixedBuffer: nocopyable {
+public:
+    FixedBuffer() : cur_(data_) {};
+
+    void append(const char* buf, size_t len) {
+        if (avail() > len) {
+            memcpy(cur_, buf, len);
+            cur_ += len;
+        }
+    }
+
+    const char* data() const { return data_; };
+    int length() const { return static_cast<int>(cur_ - data_); };
+
+    // 直接往current()写入之后用add移动写指针
+    char* current() { return cur_; };
+    size_t avail() const { return static_cast<size_t>(end() - cur_); };
+    void add(size_t len) { cur_ += len; };
+
+    void reset() { cur_ = data_; };
+    StringPiece toStringPiece() const { return StringPiece(data_, length()); };
+    std::string toString() const { return std::string(data_, length()); };
+
+private:
+    const char* end() const { return data_ + sizeof data_; };
+
+    char data_[SIZE];
+    char* cur_;
+};
+
+/*
+    流式的日志格式化，写入内联的定长缓冲区，不分配内存
+    整数用两位一组的查表转换，不经过snprintf和locale
+    LOG_*宏的printf风格格式串由appendFormat解析，常见的转换走同一套operator<<
+*/
+class LogStream: nocopyable {
+public:
+    using Buffer = FixedBuffer<kSmallBuffer>;
+
+    LogStream& operator<<(bool v) {
+        buffer_.append(v ? "1" : "0", 1);
+        return *this;
+    }
+
+    LogStream& operator<<(short);
+    LogStream& operator<<(unsigned short);
+    LogStream& operator<<(int);
+    LogStream& operator<<(unsigned int);
+    LogStream& operator<<(long);
+    LogStream& operator<<(unsigned long);
+    LogStream& operator<<(long long);
+    LogStream& operator<<(unsigned long long);
+
+    // 指针按0x开头的十六进制输出
+    LogStream& operator<<(const void*);
+
+    LogStream& operator<<(float v) {
+        *this << static_cast<double>(v);
+        return *this;
+    }
+    LogStream& operator<<(double);
+
+    LogStream& operator<<(char v) {
+        buffer_.append(&v, 1);
+        return *this;
+    }
+
+    LogStream& operator<<(const char* str) {
+        if (str) {
+            buffer_.append(str, strlen(str));
+        }
+        else {
+            buffer_.append("(null)", 6);
+        }
+        return *this;
+    }
+
+    LogStream& operator<<(const std::string &v) {
+        buffer_.append(v.data(), v.size());
+        return *this;
+    }
+
+    LogStream& operator<<(const StringPiece &v) {
+        buffer_.append(v.data(), v.size());
+        return *this;
+    }
+
+    // 按printf的格式串格式化，输出与vsnprintf一致，放不下时截断
+    // 不带标志、宽度、精度的%d %i %u %s %c %p走上面的转换，其余的交给snprintf
+    void appendFormat(const char* fmt, va_list args);
+
+    void append(const char* data, size_t len) { buffer_.append(data, len); };
+    Buffer& buffer() { return buffer_; };
+    const Buffer& buffer() const { return buffer_; };
+    void resetBuffer() { buffer_.reset(); };
+
+private:
+    template<typename T>
+    void formatInteger(T);
+    // 单个转换交给snprintf，stars是格式里'*'对应的宽度和精度
+    template<typename T>
+    void formatSpec(const char* spec, const int* stars, int starCount, T value);
+    // 和append不同，放不下时保留能放下的部分
+    void appendClipped(const char* data, size_t len);
+
+    // 64位整数最长20位，加上符号，double的%.12g也不超过这个长度
+    static const int kMaxNumericSize = 48;
+
+    Buffer buffer_;
+};
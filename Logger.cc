@@ -1,37 +1,114 @@
-#include <iostream>
+#include <stdio.h>
+#include <stdarg.h>
+#include <time.h>
 #include "Logger.h"
+#include "LogStream.h"
 #include "Timestamp.h"
 
+namespace {
+
+struct LevelName {
+    const char* str;
+    size_t len;
+};
+
+const LevelName kLevelNames[] = {
+    {"[TRACE]", 7},
+    {"[DEBUG]", 7},
+    {"[INFO]", 6},
+    {"[ERROR]", 7},
+    {"[FATAL]", 7},
+};
+
+// 每个线程缓存格式化好的"年/月/日 时:分:秒"，秒数变化时才重新生成
+__thread time_t t_lastSecond = -1;
+__thread char t_time[32];
+__thread int t_timeLen = 0;
+
+// time = 2024/01/01 12:00:00.123456
+void formatTime(LogStream &stream) {
+    int64_t microSecondsSinceEpoch = Timestamp::now(Timestamp::kRealtime).microSecondsSinceEpoch();
+    time_t seconds = static_cast<time_t>(microSecondsSinceEpoch / Timestamp::kMicroSecondsPerSecond);
+    int microseconds = static_cast<int>(microSecondsSinceEpoch % Timestamp::kMicroSecondsPerSecond);
+
+    if (seconds != t_lastSecond) {
+        t_lastSecond = seconds;
+        struct tm tm_time;
+        ::localtime_r(&seconds, &tm_time);
+        t_timeLen = snprintf(t_time, sizeof t_time, "%4d/%02d/%02d %02d:%02d:%02d",
+            tm_time.tm_year + 1900,
+            tm_time.tm_mon + 1,
+            tm_time.tm_mday,
+            tm_time.tm_hour,
+            tm_time.tm_min,
+            tm_time.tm_sec);
+    }
+    stream.append(t_time, t_timeLen);
+
+    char micros[7];
+    micros[0] = '.';
+    for (int i = 6; i > 0; --i) {
+        micros[i] = static_cast<char>('0' + microseconds % 10);
+        microseconds /= 10;
+    }
+    stream.append(micros, sizeof micros);
+}
+
+void defaultOutput(const char* msg, int len) {
+    fwrite(msg, 1, len, stdout);
+}
+
+void defaultFlush() {
+    fflush(stdout);
+}
+
+}
+
+// 运行期阈值默认与编译期的最低级别一致，MUDEBUG构建不需要再调用setLogLevel才能看到DEBUG
+std::atomic<int> Logger::logLevel_(MUDUO_MIN_LOG_LEVEL);
+Logger::OutputFunc Logger::output_ = defaultOutput;
+Logger::FlushFunc Logger::flush_ = defaultFlush;
+
+Logger::Logger() {
+
+}
+
 // 获取唯一的日志类实例对象
 Logger& Logger::instance() {
     static Logger logger;
     return logger;
 }
 
-// 设置日志级别
-void Logger::setLogLevel(int Level) {
-    logLevel_ = Level;
-}
-
 // 写日志 = [级别信息] time: msg
-void Logger::log(std::string msg) {
-    switch (logLevel_) {
-        case INFO:
-            std::cout << "[INFO]";
-            break;
-        case ERROR:
-            std::cout << "[ERROR]";
-            break;
-        case FATAL:
-            std::cout << "[FATAL]";
-            break;
-        case DEBUG:
-            std::cout << "[DEBUG]";
-            break;
-        default:
-            break;
+void Logger::log(int level, const char* fmt, ...) {
+    LogStream stream;
+    stream.append(kLevelNames[level].str, kLevelNames[level].len);
+    formatTime(stream);
+    stream.append(": ", 2);
+
+    // 调用方的格式串仍然是printf风格，由LogStream解析，整数、字符串和指针不经过vsnprintf
+    va_list args;
+    va_start(args, fmt);
+    stream.appendFormat(fmt, args);
+    va_end(args);
+
+    LogStream::Buffer &buf = stream.buffer();
+    if (buf.avail() > 1) {
+        stream << '\n';
+    }
+    else {
+        buf.current()[-1] = '\n';  // 缓冲区写满时用换行覆盖最后一个字节
     }
 
-    // print time & msg
-    std::cout << Timestamp::now().toString() << ": " << msg << std::endl;
-}
\ No newline at end of file
+    output_(buf.data(), buf.length());
+    // 普通日志交给输出端缓冲，出错时立刻刷出去
+    if (level >= ERROR) {
+        flush_();
+    }
+    // FATAL之后马上exit，异步输出端的flush只是唤醒后台线程，这一行很可能来不及落盘，
+    // 所以换了输出端时再同步写一份到stderr
+    if (level == FATAL && output_ != defaultOutput) {
+        fwrite(buf.data(), 1, buf.length(), stderr);
+        fflush(stderr);
+    }
+}
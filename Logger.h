@@ -1,70 +1,92 @@
 #pragma once
-#include <string>
+#include <atomic>
+#include <stdlib.h>
 #include "nocopyable.h"
 
+// 日志级别的数值，预处理阶段要用来比较，所以用宏定义，和下面的LogLevel一一对应
+#define MUDUO_LOG_TRACE 0
+#define MUDUO_LOG_DEBUG 1
+#define MUDUO_LOG_INFO  2
+#define MUDUO_LOG_ERROR 3
+#define MUDUO_LOG_FATAL 4
 
-// usage.eg: LOG_INFO("%s, %d", arg1, arg2)
-#define LOG_INFO(logmsgFormat, ...) \
-    do { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(INFO); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
-    }while (0)
+// 编译期的最低日志级别，低于它的LOG_*直接展开成空语句，参数也不会被求值
+// 可以通过-DMUDUO_MIN_LOG_LEVEL=0打开TRACE；定义了MUDEBUG时默认打开DEBUG
+#ifndef MUDUO_MIN_LOG_LEVEL
+#ifdef MUDEBUG
+#define MUDUO_MIN_LOG_LEVEL MUDUO_LOG_DEBUG
+#else
+#define MUDUO_MIN_LOG_LEVEL MUDUO_LOG_INFO
+#endif
+#endif
 
-#define LOG_ERROR(logmsgFormat, ...) \
+// 先比较运行期的级别阈值，通过之后才格式化
+#define MUDUO_LOG_IMPL(level, logmsgFormat, ...) \
     do { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(ERROR); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
+        if (Logger::logLevel() <= level) { \
+            Logger::instance().log(level, logmsgFormat, ##__VA_ARGS__); \
+        } \
     }while (0)
 
+// usage.eg: LOG_INFO("%s, %d", arg1, arg2)
+#if MUDUO_MIN_LOG_LEVEL <= MUDUO_LOG_TRACE
+#define LOG_TRACE(logmsgFormat, ...) MUDUO_LOG_IMPL(TRACE, logmsgFormat, ##__VA_ARGS__)
+#else
+#define LOG_TRACE(logmsgFormat, ...) do {} while (0)
+#endif
+
+#if MUDUO_MIN_LOG_LEVEL <= MUDUO_LOG_DEBUG
+#define LOG_DEBUG(logmsgFormat, ...) MUDUO_LOG_IMPL(DEBUG, logmsgFormat, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(logmsgFormat, ...) do {} while (0)
+#endif
+
+#if MUDUO_MIN_LOG_LEVEL <= MUDUO_LOG_INFO
+#define LOG_INFO(logmsgFormat, ...) MUDUO_LOG_IMPL(INFO, logmsgFormat, ##__VA_ARGS__)
+#else
+#define LOG_INFO(logmsgFormat, ...) do {} while (0)
+#endif
+
+#define LOG_ERROR(logmsgFormat, ...) MUDUO_LOG_IMPL(ERROR, logmsgFormat, ##__VA_ARGS__)
+
+// FATAL不受阈值影响，总是输出并退出
 #define LOG_FATAL(logmsgFormat, ...) \
     do { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(FATAL); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
+        Logger::instance().log(FATAL, logmsgFormat, ##__VA_ARGS__); \
         exit(-1); \
     }while (0)
 
-#ifdef MUDEBUG
-#define LOG_DEBUG(logmsgFormat, ...) \
-    do { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(DEBUG); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.buf(buf); \
-    }while (0)
-
-#else  
-    #define LOG_DEBUG(logmsgFormat, ...) 
-#endif
-
-// 定义日志的级别 INFO ERROR FATAL DEBUG
-enum {
-    INFO,   // 常规信息
-    ERROR,  // 错误信息 但不致命
-    FATAL,  // 错误信息 但致命
-    DEBUG,  // 调试信息
+// 定义日志的级别 TRACE DEBUG INFO ERROR FATAL，数值越大越严重
+enum LogLevel {
+    TRACE = MUDUO_LOG_TRACE,    // 热路径上的逐事件信息
+    DEBUG = MUDUO_LOG_DEBUG,    // 调试信息
+    INFO = MUDUO_LOG_INFO,      // 常规信息
+    ERROR = MUDUO_LOG_ERROR,    // 错误信息 但不致命
+    FATAL = MUDUO_LOG_FATAL,    // 错误信息 但致命
 };
 
 // 日志类
 class Logger: nocopyable {
 public:
+    // 日志的输出和刷新目标，默认是stdout，可以换成AsyncLogging
+    using OutputFunc = void (*)(const char* msg, int len);
+    using FlushFunc = void (*)();
+
     // 获取唯一的日志类实例对象
     // 此处采用的是懒汉式，即等到使用的时候再创建对象
     static Logger& instance();
-    // 设置日志级别
-    void setLogLevel(int Level);
-    // 写日志
-    void log(std::string msg);
+    // 运行期的级别阈值，低于它的日志不做格式化，默认等于MUDUO_MIN_LOG_LEVEL
+    static int logLevel() { return logLevel_.load(std::memory_order_relaxed); };
+    static void setLogLevel(int level) { logLevel_.store(level, std::memory_order_relaxed); };
+    // 写日志，格式化和输出在一个栈上缓冲区里一次完成
+    void log(int level, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
+
+    // 在启动工作线程之前设置；换了输出端之后FATAL日志还会同步写一份到stderr
+    static void setOutput(OutputFunc out) { output_ = out; };
+    static void setFlush(FlushFunc flush) { flush_ = flush; };
 private:
-    int logLevel_;
+    static std::atomic<int> logLevel_;
+    static OutputFunc output_;
+    static FlushFunc flush_;
     Logger();
-};
\ No newline at end of file
+};
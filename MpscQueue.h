@@ -0,0 +1,140 @@
+#pragma once
+
+#include "nocopyable.h"
+
+#include <stddef.h>
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/*
+    无锁的多生产者单消费者队列
+    - 生产者用CAS把节点压到链表头，不加锁
+    - 消费者一次exchange取走整条链表，反转后按入队顺序处理，
+      相当于原来加锁swap出整个vector的语义
+    - 节点循环使用：消费者处理完后把整批节点一次挂回free_，
+      生产者先用线程本地缓存里的节点，缓存空了再用exchange取走free_上的全部节点，
+      只有两边都没有时才new，稳定运行后入队不再分配内存
+      (free_只整体取走、不逐个弹出，所以没有ABA问题)
+    push可以在任意线程调用，consumeAll只能在唯一的消费者线程调用
+*/
+template <typename T>
+class MpscQueue : nocopyable {
+public:
+    MpscQueue()
+        : head_(nullptr)
+        , free_(nullptr) {
+
+    }
+
+    ~MpscQueue() {
+        Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+        while (node != nullptr) {
+            Node* next = node->next;
+            node->value()->~T();
+            delete node;
+            node = next;
+        }
+        deleteList(free_.exchange(nullptr, std::memory_order_acquire));
+    }
+
+    void push(T value) {
+        Node* node = allocNode();
+        ::new (&node->storage) T(std::move(value));
+        node->next = head_.load(std::memory_order_relaxed);
+        while (!head_.compare_exchange_weak(node->next, node,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+
+        }
+    }
+
+    bool empty() const { return head_.load(std::memory_order_acquire) == nullptr; };
+
+    // 取走当前所有元素，按入队顺序对每个元素调用func，返回处理的个数
+    // func执行期间新入队的元素留到下一次处理
+    template <typename Func>
+    size_t consumeAll(Func&& func) {
+        Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+        if (node == nullptr) {
+            return 0;
+        }
+
+        // 链表头是最后入队的元素，反转成先进先出
+        Node* reversed = nullptr;
+        Node* last = node;   // 反转后的最后一个节点，也就是归还链表的尾
+        while (node != nullptr) {
+            Node* next = node->next;
+            node->next = reversed;
+            reversed = node;
+            node = next;
+        }
+
+        Node* first = reversed;
+        size_t count = 0;
+        for (node = first; node != nullptr; node = node->next) {
+            func(*node->value());
+            node->value()->~T();
+            ++count;
+        }
+
+        // 整批节点一次挂回free_
+        last->next = free_.load(std::memory_order_relaxed);
+        while (!free_.compare_exchange_weak(last->next, first,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+
+        }
+        return count;
+    }
+
+private:
+    struct Node {
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+        Node* next;
+
+        T* value() { return reinterpret_cast<T*>(&storage); };
+    };
+
+    // 每个线程一份，同类型的所有队列共用，线程退出时释放
+    struct NodeCache {
+        NodeCache()
+            : head(nullptr) {
+
+        }
+
+        ~NodeCache() { deleteList(head); };
+
+        Node* head;
+    };
+
+    static NodeCache& localCache() {
+        static thread_local NodeCache cache;
+        return cache;
+    }
+
+    static void deleteList(Node* node) {
+        while (node != nullptr) {
+            Node* next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+
+    Node* allocNode() {
+        NodeCache& cache = localCache();
+        if (cache.head == nullptr) {
+            cache.head = free_.exchange(nullptr, std::memory_order_acquire);
+            if (cache.head == nullptr) {
+                return new Node;
+            }
+        }
+        Node* node = cache.head;
+        cache.head = node->next;
+        return node;
+    }
+
+    std::atomic<Node*> head_;
+    std::atomic<Node*> free_;   // 消费者归还的空闲节点
+};
@@ -1,12 +1,58 @@
 #include "Poller.h"
 #include "Channel.h"
+#include "Logger.h"
+
+#include <algorithm>
 
 Poller::Poller(EventLoop* loop)
-    :ownerLoop_(loop) {
+    : numChannels_(0)
+    , ctlCalls_(0)
+    , ownerLoop_(loop) {
+
+}
+
+Poller::~Poller() {
 
 }
 
 bool Poller::hasChannel(Channel* channel) const {
-    auto it = channels_.find(channel->fd());
-    return it != channels_.end() && it->second == channel;
-}
\ No newline at end of file
+    const ChannelSlot* slot = findSlot(channel->fd());
+    return slot != nullptr && slot->channel == channel;
+}
+
+Poller::ChannelSlot& Poller::slotFor(int fd) {
+    if (static_cast<size_t>(fd) >= channels_.size()) {
+        // 按倍数扩容，新槽都是空的
+        size_t size = std::max(static_cast<size_t>(fd) + 1, std::max(channels_.size() * 2, static_cast<size_t>(64)));
+        ChannelSlot empty;
+        empty.channel = nullptr;
+        empty.generation = 0;
+        empty.state = kNew;
+        channels_.resize(size, empty);
+    }
+    return channels_[fd];
+}
+
+Poller::ChannelSlot& Poller::installChannel(Channel* channel) {
+    ChannelSlot& slot = slotFor(channel->fd());
+    if (slot.channel != nullptr) {
+        // 旧的channel没有remove就被替换，说明使用方有bug
+        LOG_ERROR("Poller::installChannel fd=%d is already owned by another channel \n", channel->fd());
+    }
+    else {
+        ++numChannels_;
+    }
+    slot.channel = channel;
+    ++slot.generation;
+    slot.state = kNew;
+    return slot;
+}
+
+void Poller::uninstallChannel(Channel* channel) {
+    ChannelSlot& slot = slotFor(channel->fd());
+    if (slot.channel == channel) {
+        slot.channel = nullptr;
+        slot.state = kNew;
+        --numChannels_;
+    }
+}
@@ -3,7 +3,8 @@
 #include "nocopyable.h"
 #include "Timestamp.h"
 #include <vector>
-#include <unordered_map>
+#include <atomic>
+#include <stdint.h>
 
 class Channel;
 class EventLoop;
@@ -21,16 +22,52 @@ public:
     virtual void updateChannel(Channel* channel) = 0;
     virtual void removeChannel(Channel* channel) = 0;
 
+    // 向内核提交关注事件修改的次数（epoll_ctl调用次数，或者io_uring的poll请求个数），可以在任意线程读取
+    int64_t ctlCalls() const { return ctlCalls_.load(std::memory_order_relaxed); };
+
     // 判断所查询channel是否在当前Poller中
     bool hasChannel(Channel* channel) const;
 
+    // IO复用的具体实现
+    enum Backend {
+        kDefault,   // 设置了环境变量MUDUO_USE_IO_URING时使用io_uring，否则epoll
+        kEpoll,
+        kIoUring,   // 内核不支持时退回epoll
+    };
+
     // EventLoop可以通过该接口获取默认的IO复用的具体实现
-    static Poller* newDefaultPoller(EventLoop* loop);
+    static Poller* newDefaultPoller(EventLoop* loop, Backend backend = kDefault);
 
 protected:
-    // channelmap的key：sockfd，value：sockfd所属的channel通道
-    using ChannelMap = std::unordered_map<int, Channel*>;
-    ChannelMap channels_;
+    // channel在poller中的注册状态
+    enum SlotState {
+        kNew = -1,      // channel未添加到poller中
+        kAdded = 1,     // channel已添加到poller中
+        kDeleted = 2,   // channel不关注任何事件，已从内核中撤下
+    };
+
+    // fd是从小到大复用的整数，直接以fd为下标存放channel，代替哈希表
+    // 注册状态和channel指针放在一起，一次访问就能拿到
+    struct ChannelSlot {
+        Channel* channel;       // nullptr表示该fd没有channel
+        uint32_t generation;    // 每次有新的channel占用该fd时加一，用于识别过期的事件
+        int state;
+    };
+
+    // 返回fd对应的槽，必要时扩容
+    ChannelSlot& slotFor(int fd);
+    // 只查找不扩容，fd超出范围时返回nullptr
+    const ChannelSlot* findSlot(int fd) const {
+        return (fd >= 0 && static_cast<size_t>(fd) < channels_.size()) ? &channels_[fd] : nullptr;
+    }
+    // 把channel放进fd对应的槽
+    ChannelSlot& installChannel(Channel* channel);
+    // 清空channel所在的槽
+    void uninstallChannel(Channel* channel);
+
+    std::vector<ChannelSlot> channels_;
+    size_t numChannels_;    // 当前注册的channel个数
+    std::atomic<int64_t> ctlCalls_;
 
 private:
     EventLoop* ownerLoop_;
@@ -0,0 +1,152 @@
+#include "SimdSearch.h"
+
+#include <stddef.h>
+
+#if defined(__x86_64__)
+#define MUDUO_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using FindByteFunc = const char* (*)(const char*, const char*, char);
+using FindCRLFFunc = const char* (*)(const char*, const char*);
+
+const char* findByteScalar(const char* begin, const char* end, char c) {
+    for (const char* p = begin; p < end; ++p) {
+        if (*p == c) {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+const char* findCRLFScalar(const char* begin, const char* end) {
+    for (const char* p = begin; p + 1 < end; ++p) {
+        if (p[0] == '\r' && p[1] == '\n') {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+#ifdef MUDUO_SIMD_X86
+
+// 每次比较16字节，movemask得到每个字节是否命中的位图
+const char* findByteSse2(const char* begin, const char* end, char c) {
+    const __m128i needle = _mm_set1_epi8(c);
+    const char* p = begin;
+    for (; p + 16 <= end; p += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return findByteScalar(p, end, c);
+}
+
+// 同时比较p处的'\r'和p + 1处的'\n'，两个位图相与即为"\r\n"的位置
+const char* findCRLFSse2(const char* begin, const char* end) {
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+    const char* p = begin;
+    for (; p + 17 <= end; p += 16) {
+        __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+        int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, cr),
+                                                   _mm_cmpeq_epi8(second, lf)));
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return findCRLFScalar(p, end);
+}
+
+__attribute__((target("avx2")))
+const char* findByteAvx2(const char* begin, const char* end, char c) {
+    const __m256i needle = _mm256_set1_epi8(c);
+    const char* p = begin;
+    for (; p + 32 <= end; p += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return findByteSse2(p, end, c);
+}
+
+__attribute__((target("avx2")))
+const char* findCRLFAvx2(const char* begin, const char* end) {
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lf = _mm256_set1_epi8('\n');
+    const char* p = begin;
+    for (; p + 33 <= end; p += 32) {
+        __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+                            _mm256_and_si256(_mm256_cmpeq_epi8(first, cr),
+                                             _mm256_cmpeq_epi8(second, lf))));
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return findCRLFSse2(p, end);
+}
+
+bool hasAvx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+struct Kernels {
+    FindByteFunc findByte;
+    FindCRLFFunc findCRLF;
+    const char* name;
+};
+
+// 第一次调用时探测一次CPU特性，之后直接走函数指针
+const Kernels& kernels() {
+#ifdef MUDUO_SIMD_X86
+    static const Kernels k = hasAvx2()
+        ? Kernels{findByteAvx2, findCRLFAvx2, "avx2"}
+        : Kernels{findByteSse2, findCRLFSse2, "sse2"};
+#else
+    static const Kernels k = {findByteScalar, findCRLFScalar, "scalar"};
+#endif
+    return k;
+}
+
+}
+
+namespace SimdSearch {
+    const char* findByte(const char* begin, const char* end, char c) {
+        return kernels().findByte(begin, end, c);
+    }
+
+    const char* findCRLF(const char* begin, const char* end) {
+        return kernels().findCRLF(begin, end);
+    }
+
+    const char* implName() {
+        return kernels().name;
+    }
+
+    const std::vector<Impl>& availableImpls() {
+        static const std::vector<Impl> impls = []() {
+            std::vector<Impl> v;
+            v.push_back(Impl{"scalar", findByteScalar, findCRLFScalar});
+#ifdef MUDUO_SIMD_X86
+            v.push_back(Impl{"sse2", findByteSse2, findCRLFSse2});
+            if (hasAvx2()) {
+                v.push_back(Impl{"avx2", findByteAvx2, findCRLFAvx2});
+            }
+#endif
+            return v;
+        }();
+        return impls;
+    }
+}
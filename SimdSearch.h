@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+
+/*
+    在【begin, end)区间内查找分隔符，找不到时返回nullptr
+    x86上运行时检测CPU，依次选用AVX2 / SSE2实现，其他平台使用逐字节查找
+*/
+namespace SimdSearch {
+    // 查找第一个等于c的字节
+    const char* findByte(const char* begin, const char* end, char c);
+
+    // 查找第一个"\r\n"，返回'\r'的位置
+    const char* findCRLF(const char* begin, const char* end);
+
+    // 当前使用的实现："avx2"、"sse2"或"scalar"
+    const char* implName();
+
+    // 当前CPU上可用的全部实现，第一个是逐字节查找的参考实现，供测试和性能测试逐一对比
+    struct Impl {
+        const char* name;
+        const char* (*findByte)(const char* begin, const char* end, char c);
+        const char* (*findCRLF)(const char* begin, const char* end);
+    };
+    const std::vector<Impl>& availableImpls();
+}
@@ -0,0 +1,58 @@
+#include "SlabArena.h"
+
+#include <new>
+#include <string.h>
+
+SlabArena::SlabArena() {
+    ::memset(freeLists_, 0, sizeof freeLists_);
+}
+
+SlabArena::~SlabArena() {
+    for (char* chunk : chunks_) {
+        ::operator delete(chunk);
+    }
+}
+
+void* SlabArena::allocate(size_t size) {
+    if (size == 0 || size > kMaxSlotSize) {
+        return ::operator new(size);
+    }
+    size_t index = classIndex(size);
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (freeLists_[index] == nullptr) {
+        refill(index);
+    }
+    FreeSlot* slot = freeLists_[index];
+    freeLists_[index] = slot->next;
+    return slot;
+}
+
+void SlabArena::deallocate(void* p, size_t size) {
+    if (size == 0 || size > kMaxSlotSize) {
+        ::operator delete(p);
+        return;
+    }
+    size_t index = classIndex(size);
+    FreeSlot* slot = static_cast<FreeSlot*>(p);
+    std::unique_lock<std::mutex> lock(mutex_);
+    slot->next = freeLists_[index];
+    freeLists_[index] = slot;
+}
+
+size_t SlabArena::chunkCount() const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return chunks_.size();
+}
+
+// 申请一个chunk，全部切成index档的槽位挂到空闲链表上，调用方已持有锁
+void SlabArena::refill(size_t index) {
+    const size_t slotSize = (index + 1) * kSlotAlign;
+    char* chunk = static_cast<char*>(::operator new(kChunkSize));
+    chunks_.push_back(chunk);
+
+    for (size_t offset = 0; offset + slotSize <= kChunkSize; offset += slotSize) {
+        FreeSlot* slot = reinterpret_cast<FreeSlot*>(chunk + offset);
+        slot->next = freeLists_[index];
+        freeLists_[index] = slot;
+    }
+}
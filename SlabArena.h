@@ -0,0 +1,88 @@
+#pragma once
+
+#include "nocopyable.h"
+
+#include <stddef.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/*
+    每个EventLoop持有一个SlabArena，连接对象从其所属loop的arena中分配
+    - 按64字节为一档划分大小类，每一档维护一个空闲链表
+    - 空闲链表为空时，从一个大块(chunk)上一次切出一批槽位
+    - 超过kMaxSlotSize的请求直接交给operator new
+    连接在baseloop中创建、在subloop中释放，所以分配和释放都要加锁，
+    但锁只在这两个线程之间竞争，不会像glibc的malloc那样在所有线程间争抢
+*/
+class SlabArena : nocopyable {
+public:
+    static const size_t kSlotAlign = 64;
+    static const size_t kMaxSlotSize = 2048;
+    static const size_t kChunkSize = 64 * 1024;
+
+    SlabArena();
+    ~SlabArena();
+
+    void* allocate(size_t size);
+    void deallocate(void* p, size_t size);
+
+    // 向系统申请过的chunk个数
+    size_t chunkCount() const;
+
+private:
+    struct FreeSlot {
+        FreeSlot* next;
+    };
+
+    static const size_t kNumClasses = kMaxSlotSize / kSlotAlign;
+
+    static size_t classIndex(size_t size) { return (size + kSlotAlign - 1) / kSlotAlign - 1; };
+    void refill(size_t index);
+
+    mutable std::mutex mutex_;
+    FreeSlot* freeLists_[kNumClasses];
+    std::vector<char*> chunks_;
+};
+
+// 供std::allocate_shared等STL设施使用的分配器，持有arena的引用计数，
+// 保证即使loop先析构，晚释放的对象仍能安全地归还内存
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(const std::shared_ptr<SlabArena>& arena)
+        : arena_(arena) {
+
+    }
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other)
+        : arena_(other.arena()) {
+
+    }
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(arena_->allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) {
+        arena_->deallocate(p, n * sizeof(T));
+    }
+
+    const std::shared_ptr<SlabArena>& arena() const { return arena_; };
+
+private:
+    std::shared_ptr<SlabArena> arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) {
+    return lhs.arena() == rhs.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) {
+    return !(lhs == rhs);
+}
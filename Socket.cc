@@ -7,6 +7,20 @@
 #include <sys/socket.h>
 #include <strings.h>
 #include <netinet/tcp.h>
+#include <linux/filter.h>
+
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef SO_BUSY_POLL
+#define SO_BUSY_POLL 46
+#endif
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL 69
+#endif
+#ifndef SO_ATTACH_REUSEPORT_CBPF
+#define SO_ATTACH_REUSEPORT_CBPF 51
+#endif
 
 Socket::~Socket() {
     ::close(sockfd_);
@@ -27,9 +41,10 @@ void Socket::listen() {
 
 int Socket::accept(InetAddress *peeraddr) {
     sockaddr_in addr;
-    socklen_t len;
+    socklen_t len = sizeof addr;
     bzero(&addr, sizeof addr);
-    int connfd = ::accept(sockfd_, (sockaddr*)&addr, &len);
+    // 连接socket必须是非阻塞的，否则读写到EAGAIN的循环会阻塞住整个loop
+    int connfd = ::accept4(sockfd_, (sockaddr*)&addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
     if (connfd >= 0) {
         peeraddr->setSockAddr(addr);
     }
@@ -59,4 +74,33 @@ void Socket::setReusePort(bool on) {
 void Socket::setKeepAlive(bool on) {
     int optVal = on? 1: 0;
     ::setsockopt(sockfd_, SOL_SOCKET, SO_KEEPALIVE, &optVal, sizeof optVal);
-}
\ No newline at end of file
+}
+
+bool Socket::setZeroCopy(bool on) {
+    int optVal = on? 1: 0;
+    return ::setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY, &optVal, sizeof optVal) == 0;
+}
+
+bool Socket::setBusyPoll(int usec, bool prefer) {
+    if (::setsockopt(sockfd_, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof usec) < 0) {
+        return false;
+    }
+    if (prefer) {
+        int optVal = 1;
+        return ::setsockopt(sockfd_, SOL_SOCKET, SO_PREFER_BUSY_POLL, &optVal, sizeof optVal) == 0;
+    }
+    return true;
+}
+
+bool Socket::setReusePortCpuSteering(int numSockets) {
+    // A = 当前CPU编号; A = A % numSockets; return A
+    struct sock_filter code[] = {
+        { BPF_LD | BPF_W | BPF_ABS, 0, 0, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU) },
+        { BPF_ALU | BPF_MOD | BPF_K, 0, 0, static_cast<uint32_t>(numSockets) },
+        { BPF_RET | BPF_A, 0, 0, 0 },
+    };
+    struct sock_fprog prog;
+    prog.len = sizeof code / sizeof code[0];
+    prog.filter = code;
+    return ::setsockopt(sockfd_, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof prog) == 0;
+}
@@ -26,6 +26,14 @@ public:
     void setReuseAddr(bool on);
     void setReusePort(bool on);
     void setKeepAlive(bool on);
+    // 开启SO_ZEROCOPY，之后才能使用MSG_ZEROCOPY发送；内核不支持时返回false
+    bool setZeroCopy(bool on);
+    // 设置SO_BUSY_POLL（微秒），prefer为true时同时设置SO_PREFER_BUSY_POLL；
+    // 超过net.core.busy_read需要CAP_NET_ADMIN，失败时返回false
+    bool setBusyPoll(int usec, bool prefer);
+    // 给这个socket所在的SO_REUSEPORT组挂上CBPF程序，按处理软中断的CPU选择组内第cpu % numSockets个socket
+    // 组内顺序就是各socket调用listen的顺序；需要在listen之后调用
+    bool setReusePortCpuSteering(int numSockets);
 private:
     const int sockfd_;
 };
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string.h>
+#include <string>
+
+// 不持有内存的只读字符串视图，指向的数据由调用方保证有效
+// 用法上类似C++17的std::string_view
+class StringPiece {
+public:
+    StringPiece()
+        : ptr_(nullptr), length_(0) {
+
+    }
+    StringPiece(const char* str)
+        : ptr_(str), length_(strlen(str)) {
+
+    }
+    StringPiece(const std::string& str)
+        : ptr_(str.data()), length_(str.size()) {
+
+    }
+    StringPiece(const char* offset, size_t len)
+        : ptr_(offset), length_(len) {
+
+    }
+
+    const char* data() const { return ptr_; };
+    size_t size() const { return length_; };
+    bool empty() const { return length_ == 0; };
+    const char* begin() const { return ptr_; };
+    const char* end() const { return ptr_ + length_; };
+
+    char operator[](size_t i) const { return ptr_[i]; };
+
+    void removePrefix(size_t n) {
+        ptr_ += n;
+        length_ -= n;
+    }
+
+    bool startsWith(const StringPiece& x) const {
+        return length_ >= x.length_ && memcmp(ptr_, x.ptr_, x.length_) == 0;
+    }
+
+    bool operator==(const StringPiece& x) const {
+        return length_ == x.length_ && memcmp(ptr_, x.ptr_, length_) == 0;
+    }
+    bool operator!=(const StringPiece& x) const {
+        return !(*this == x);
+    }
+
+    // 需要长期保存时再显式拷贝出来
+    std::string asString() const { return std::string(ptr_, length_); };
+
+private:
+    const char* ptr_;
+    size_t length_;
+};
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <stddef.h>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/*
+    只能移动的void()可调用对象，用作EventLoop::Functor
+    - 不超过kInlineSize字节、且移动构造不抛异常的可调用对象直接存放在对象内部，不分配内存
+    - 更大的可调用对象退化为堆上分配，和std::function一样
+    std::function要求可拷贝且小对象缓冲区只有16字节，
+    绑定了shared_ptr<TcpConnection>和参数的std::bind几乎每次都要new一次
+*/
+class Task {
+public:
+    static const size_t kInlineSize = 64;
+
+    Task()
+        : ops_(nullptr) {
+
+    }
+
+    Task(std::nullptr_t)
+        : ops_(nullptr) {
+
+    }
+
+    template <typename F,
+              typename = typename std::enable_if<
+                  !std::is_same<typename std::decay<F>::type, Task>::value>::type>
+    Task(F&& f)
+        : ops_(nullptr) {
+        using Func = typename std::decay<F>::type;
+        init<Func>(std::forward<F>(f), std::integral_constant<bool, fitsInline<Func>()>());
+    }
+
+    Task(Task&& other) noexcept
+        : ops_(other.ops_) {
+        if (ops_ != nullptr) {
+            ops_->move(&storage_, &other.storage_);
+            other.ops_ = nullptr;
+        }
+    }
+
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            if (other.ops_ != nullptr) {
+                other.ops_->move(&storage_, &other.storage_);
+                ops_ = other.ops_;
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() { reset(); };
+
+    void operator()() const { ops_->invoke(const_cast<Storage*>(&storage_)); };
+
+    explicit operator bool() const { return ops_ != nullptr; };
+
+    // 可调用对象是否存放在对象内部
+    bool isInline() const { return ops_ != nullptr && ops_->isInline; };
+
+private:
+    using Storage = typename std::aligned_storage<kInlineSize>::type;
+
+    // 每种可调用对象类型一张操作表，相当于手写的虚函数表
+    struct Ops {
+        void (*invoke)(void* storage);
+        void (*move)(void* dst, void* src);    // 移动到dst并析构src
+        void (*destroy)(void* storage);
+        bool isInline;
+    };
+
+    template <typename Func>
+    static constexpr bool fitsInline() {
+        return sizeof(Func) <= kInlineSize
+            && alignof(Func) <= alignof(Storage)
+            && std::is_nothrow_move_constructible<Func>::value;
+    }
+
+    template <typename Func>
+    struct InlineOps {
+        static void invoke(void* storage) { (*static_cast<Func*>(storage))(); };
+        static void move(void* dst, void* src) {
+            Func* from = static_cast<Func*>(src);
+            ::new (dst) Func(std::move(*from));
+            from->~Func();
+        }
+        static void destroy(void* storage) { static_cast<Func*>(storage)->~Func(); };
+        static const Ops ops;
+    };
+
+    // 堆上的可调用对象，storage_中只保存指针
+    template <typename Func>
+    struct HeapOps {
+        static Func*& ptr(void* storage) { return *static_cast<Func**>(storage); };
+        static void invoke(void* storage) { (*ptr(storage))(); };
+        static void move(void* dst, void* src) { ::new (dst) Func*(ptr(src)); };
+        static void destroy(void* storage) { delete ptr(storage); };
+        static const Ops ops;
+    };
+
+    template <typename Func, typename F>
+    void init(F&& f, std::true_type) {
+        ::new (&storage_) Func(std::forward<F>(f));
+        ops_ = &InlineOps<Func>::ops;
+    }
+
+    template <typename Func, typename F>
+    void init(F&& f, std::false_type) {
+        ::new (&storage_) Func*(new Func(std::forward<F>(f)));
+        ops_ = &HeapOps<Func>::ops;
+    }
+
+    void reset() {
+        if (ops_ != nullptr) {
+            ops_->destroy(&storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    const Ops* ops_;
+    Storage storage_;
+};
+
+template <typename Func>
+const Task::Ops Task::InlineOps<Func>::ops = {
+    &Task::InlineOps<Func>::invoke,
+    &Task::InlineOps<Func>::move,
+    &Task::InlineOps<Func>::destroy,
+    true
+};
+
+template <typename Func>
+const Task::Ops Task::HeapOps<Func>::ops = {
+    &Task::HeapOps<Func>::invoke,
+    &Task::HeapOps<Func>::move,
+    &Task::HeapOps<Func>::destroy,
+    false
+};
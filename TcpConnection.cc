@@ -5,6 +5,16 @@
 #include "EventLoop.h"
 
 #include <errno.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#include <strings.h>
+
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#include <algorithm>
 #include <string>
 
 static EventLoop* CheckLoopNotNull(EventLoop* loop) {
@@ -23,38 +33,108 @@ TcpConnection::TcpConnection(EventLoop* loop,
     , name_(nameArg)
     , state_(kConnecting)
     , reading_(true)
-    , socket_(new Socket(sockfd))
-    , channel_(new Channel(loop, sockfd))
+    , socket_(sockfd)
+    , channel_(loop, sockfd)
     , localAddr_(localAddr)
     , peerAddr_(peerAddr)
-    , highWaterMark_(64 * 1024 * 1024) {
+    , highWaterMark_(64 * 1024 * 1024)
+    , backpressureHigh_(0)
+    , backpressureLow_(0)
+    , sourcePaused_(false)
+    , outputBuffer_(loop_->blockPool())
+    , autoCork_(false)
+    , flushScheduled_(false)
+    , zeroCopyThreshold_(0)
+    , zeroCopyNextSeq_(0)
+    , zeroCopyAckedSeq_(0)
+    , bufferActive_(false)
+    , inputPeak_(0)
+    , reportedBufferBytes_(0)
+    , reclaimId_(-1)
+    , idleTimeoutSec_(0) {
     
     // 给channel设置相应的回调函数， poller给channel通知感兴趣的事件发生，channel会回调相应的操作函数
-    channel_->setReadCallback(std::bind(&TcpConnection::handleRead, this, std::placeholders::_1));
-    channel_->setWriteCallback(std::bind(&TcpConnection::handleWrite, this));
-    channel_->setCloseCallback(std::bind(&TcpConnection::handleClose, this));
-    channel_->setErrorCallback(std::bind(&TcpConnection::handleError, this));
+    channel_.setReadCallback(std::bind(&TcpConnection::handleRead, this, std::placeholders::_1));
+    channel_.setWriteCallback(std::bind(&TcpConnection::handleWrite, this));
+    channel_.setCloseCallback(std::bind(&TcpConnection::handleClose, this));
+    channel_.setErrorCallback(std::bind(&TcpConnection::handleError, this));
 
     LOG_INFO("TcpConnetion::ctor[%s] at fd = %d\n", name_.c_str(), sockfd);
-    socket_->setKeepAlive(true);
+    socket_.setKeepAlive(true);
+    if (loop_->socketBusyPollMicros() > 0
+            && !socket_.setBusyPoll(loop_->socketBusyPollMicros(), true)) {
+        LOG_ERROR("TcpConnection::ctor[%s] SO_BUSY_POLL failed:%d \n", name_.c_str(), errno);
+    }
 }
 
 TcpConnection::~TcpConnection() {
     LOG_INFO("TcpConnection::dtor[%s] at fd = %d state = %d \n",
-            name_.c_str(), channel_->fd(), (int)state_);
+            name_.c_str(), channel_.fd(), (int)state_);
+    loop_->addBufferBytes(-reportedBufferBytes_);
 }
 
 void TcpConnection::send(const std::string& buf) {
     if (state_ == kConnected) {
         if (loop_->isInLoopThread()) {
-            sendInLoop(buf.c_str(), buf.size());
+            sendInLoop(buf.data(), buf.size());
+        }
+        else {
+            // 跨线程时buf可能在回调执行前就失效，只能拷贝一份绑定到回调里
+            loop_->runInLoop(std::bind(
+                &TcpConnection::sendStringInLoop,
+                shared_from_this(),
+                buf
+            ));
+        }
+    }
+}
+
+void TcpConnection::send(std::string&& buf) {
+    if (state_ == kConnected) {
+        // 这里只决定走哪条路径，sendZeroCopyInLoop在loop线程中会按当时的阈值再判断一次
+        size_t threshold = zeroCopyThreshold_.load(std::memory_order_relaxed);
+        if (threshold > 0 && buf.size() >= threshold) {
+            // 大payload移动进引用计数的payload中零拷贝发送
+            sendZeroCopy(std::make_shared<const std::string>(std::move(buf)));
+        }
+        else if (loop_->isInLoopThread()) {
+            sendInLoop(buf.data(), buf.size());
+        }
+        else {
+            // 把payload移动到回调里，不拷贝
+            loop_->runInLoop(std::bind(
+                &TcpConnection::sendStringInLoop,
+                shared_from_this(),
+                std::move(buf)
+            ));
+        }
+    }
+}
+
+void TcpConnection::send(const void* data, size_t len) {
+    if (state_ == kConnected) {
+        if (loop_->isInLoopThread()) {
+            sendInLoop(data, len);
         }
         else {
+            send(std::string(static_cast<const char*>(data), len));
+        }
+    }
+}
+
+void TcpConnection::send(Buffer* buf) {
+    if (state_ == kConnected) {
+        if (loop_->isInLoopThread()) {
+            sendBufferInLoop(*buf);
+        }
+        else {
+            // 把buf的存储交换出来移动到回调里，调用方拿到的是一个空Buffer
+            Buffer message(0);
+            message.swap(*buf);
             loop_->runInLoop(std::bind(
-                &TcpConnection::sendInLoop,
-                this,
-                buf.c_str(),
-                buf.size()
+                &TcpConnection::sendBufferInLoop,
+                shared_from_this(),
+                std::move(message)
             ));
         }
     }
@@ -73,66 +153,392 @@ void TcpConnection::shutdown() {
     发送数据时，如果应用写的快，而内核发送数据慢，则需要把待发送数据写入缓冲区，并且设置了水位回调
 */ 
 void TcpConnection::sendInLoop(const void* data, size_t len) {
-    ssize_t nwrote = 0;         // 
-    size_t remaining = len;     // 未发送完的数据
+    // 此前调用过该connection的shutdown，无法再发送
+    if (state_ == kDisconnected) {
+        LOG_ERROR("Disconnected, give up writing!");
+        return;
+    }
+    bufferActive_ = true;
+
     bool faultError = false;    // 是否产生错误 
+    size_t nwrote = writeDirectly(data, len, &faultError);
+    size_t remaining = len - nwrote;     // 未发送完的数据
 
-    // 此前调用过该connection的shutdown，无法再发送
+    // 说明当前这一次write，并没有把数据全部发送出去，剩余的数据需要保存到output缓冲区当中，
+    // 然后给channel注册epollout事件，poller发现tcp的发送缓冲区有空间，会通知相应的sock - channel，调用writeCallback_回调方法
+    // 也就是调用TcpConnection::handleWrite方法，把发送缓冲区中的数据全部发送完成
+    if (!faultError && remaining > 0) {
+        checkHighWaterMark(remaining);
+        outputBuffer_.append(static_cast<const char*>(data) + nwrote, remaining);  // 将未发送数据写到缓冲区中
+        queueOutput();
+    }
+}
+
+void TcpConnection::sendStringInLoop(const std::string& message) {
+    sendInLoop(message.data(), message.size());
+}
+
+// buf可能是调用方的Buffer，也可能是跨线程时绑定在回调里的Buffer，剩余的数据直接交换进outputBuffer_
+void TcpConnection::sendBufferInLoop(Buffer& buf) {
     if (state_ == kDisconnected) {
         LOG_ERROR("Disconnected, give up writing!");
         return;
     }
+    bufferActive_ = true;
 
-    // channel_第一次开始写数据，且缓冲区中没有待发送数据
-    if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0) {
-        nwrote = ::write(channel_->fd(), data, len);
-        if (nwrote >= 0) {  // 发送成功
-            remaining = len - nwrote;   
-            if (remaining == 0 && writeCompleteCallback_) {
-                // 在这里数据已全部发送完成，无须给channel设置epollout事件
-                loop_->queueInLoop(
-                    std::bind(writeCompleteCallback_, shared_from_this())
-                );
-            }
+    bool faultError = false;
+    size_t nwrote = writeDirectly(buf.peek(), buf.readableBytes(), &faultError);
+    buf.retrieve(nwrote);
+    size_t remaining = buf.readableBytes();
+
+    if (!faultError && remaining > 0) {
+        checkHighWaterMark(remaining);
+        if (remaining < kMinAdoptBytes) {
+            // 数据不多时拷贝比多占一个块更划算
+            outputBuffer_.append(buf.peek(), remaining);
+            buf.retrieveAll();
         }
-        else { // nwrote < 0
-            nwrote = 0;
-            if (errno != EWOULDBLOCK) { // EWOULDBLOCK表示非阻塞却没有发送数据
-                LOG_ERROR("TcpConnection::sendInLoop");
-                if (errno == EPIPE || errno == ECONNRESET) // SIGPIPE  RESET
-                {
-                    faultError = true;
-                }
-            }
+        else {
+            outputBuffer_.appendBuffer(&buf);
         }
+        queueOutput();
     }
+    else {
+        buf.retrieveAll();
+    }
+}
 
-    // 说明当前这一次write，并没有把数据全部发送出去，剩余的数据需要保存到output缓冲区当中，
-    // 然后给channel注册epollout事件，poller发现tcp的发送缓冲区有空间，会通知相应的sock - channel，调用writeCallback_回调方法
-    // 也就是调用TcpConnection::handleWrite方法，把发送缓冲区中的数据全部发送完成
-    if (!faultError && remaining > 0) 
-    {
-        // 目前发送缓冲区剩余的待发送数据的长度
-        size_t oldLen = outputBuffer_.readableBytes();
-        if (oldLen + remaining >= highWaterMark_
-            && oldLen < highWaterMark_
-            && highWaterMarkCallback_)
-        {
+// channel_没有在写，且缓冲区中没有待发送数据时，先尝试直接写，返回写出的字节数
+size_t TcpConnection::writeDirectly(const void* data, size_t len, bool* faultError) {
+    // 写合并模式下统一留到本轮结束时再写
+    if (autoCork_ || channel_.isWriting() || outputBuffer_.readableBytes() != 0) {
+        return 0;
+    }
+
+    ssize_t nwrote = ::write(channel_.fd(), data, len);
+    if (nwrote >= 0) {  // 发送成功
+        touchIdle();
+        if (static_cast<size_t>(nwrote) == len && writeCompleteCallback_) {
+            // 在这里数据已全部发送完成，无须给channel设置epollout事件
             loop_->queueInLoop(
-                std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining)
+                std::bind(writeCompleteCallback_, shared_from_this())
             );
         }
-        outputBuffer_.append((char*)data + nwrote, remaining);  // 将未发送数据写到缓冲区中
-        if (!channel_->isWriting())
-        {
-            channel_->enableWriting(); // 这里一定要注册channel的写事件，否则poller不会给channel通知epollout
+        return nwrote;
+    }
+
+    if (errno != EWOULDBLOCK) { // EWOULDBLOCK表示非阻塞却没有发送数据
+        LOG_ERROR("TcpConnection::sendInLoop");
+        if (errno == EPIPE || errno == ECONNRESET) { // SIGPIPE  RESET
+            *faultError = true;
+        }
+    }
+    return 0;
+}
+
+void TcpConnection::sendFile(int fd, off_t offset, size_t len) {
+    if (state_ == kConnected) {
+        if (loop_->isInLoopThread()) {
+            sendFileInLoop(fd, offset, len);
         }
+        else {
+            loop_->runInLoop(std::bind(
+                &TcpConnection::sendFileInLoop,
+                shared_from_this(),
+                fd,
+                offset,
+                len
+            ));
+        }
+    }
+}
+
+void TcpConnection::sendFileInLoop(int fd, off_t offset, size_t len) {
+    if (state_ == kDisconnected) {
+        LOG_ERROR("Disconnected, give up sending file!");
+        return;
+    }
+    if (len == 0) {
+        return;
+    }
+
+    // 前面没有排队的数据时先尝试直接发送
+    if (!channel_.isWriting() && outputBuffer_.readableBytes() == 0) {
+        ssize_t n = ::sendfile(channel_.fd(), fd, &offset, len);
+        if (n > 0) {
+            touchIdle();
+            len -= n;
+            if (len == 0) {
+                if (writeCompleteCallback_) {
+                    loop_->queueInLoop(
+                        std::bind(writeCompleteCallback_, shared_from_this()));
+                }
+                return;
+            }
+        }
+        else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            // 文件发不完整，之后的数据再发出去对端就会错位，只能断开连接
+            LOG_ERROR("TcpConnection::sendFileInLoop fd = %d errno = %d, closing \n", fd, n == 0 ? 0 : errno);
+            forceCloseInLoop();
+            return;
+        }
+    }
+
+    PendingWrite file;
+    file.fd = fd;
+    file.offset = offset;
+    file.remaining = len;
+    file.zeroCopied = false;
+    file.lastSeq = 0;
+    queuePendingWrite(file);
+}
+
+void TcpConnection::sendZeroCopy(const ZeroCopyPayload& payload) {
+    if (state_ == kConnected) {
+        if (loop_->isInLoopThread()) {
+            sendZeroCopyInLoop(payload);
+        }
+        else {
+            loop_->runInLoop(std::bind(
+                &TcpConnection::sendZeroCopyInLoop,
+                shared_from_this(),
+                payload
+            ));
+        }
+    }
+}
+
+void TcpConnection::sendZeroCopyInLoop(const ZeroCopyPayload& payload) {
+    size_t threshold = zeroCopyThreshold_.load(std::memory_order_relaxed);
+    if (threshold == 0 || payload->size() < threshold) {
+        // 小payload的页固定和完成通知开销比拷贝还大
+        sendInLoop(payload->data(), payload->size());
+        return;
+    }
+    if (state_ == kDisconnected) {
+        LOG_ERROR("Disconnected, give up writing!");
+        return;
+    }
+    bufferActive_ = true;
+
+    PendingWrite write;
+    write.fd = -1;
+    write.offset = 0;
+    write.remaining = payload->size();
+    write.payload = payload;
+    write.zeroCopied = false;
+    write.lastSeq = 0;
+
+    // 前面没有排队的数据时先尝试直接发送
+    if (!channel_.isWriting() && outputBuffer_.readableBytes() == 0) {
+        ssize_t n = writePending(write);
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            // 与sendFileInLoop一致，后面的数据不能跳过这段payload发出去
+            LOG_ERROR("TcpConnection::sendZeroCopyInLoop errno = %d, closing \n", errno);
+            forceCloseInLoop();
+            return;
+        }
+        if (n > 0) {
+            touchIdle();
+        }
+        if (write.remaining == 0) {
+            if (writeCompleteCallback_) {
+                loop_->queueInLoop(
+                    std::bind(writeCompleteCallback_, shared_from_this()));
+            }
+            return;
+        }
+    }
+    queuePendingWrite(write);
+}
+
+void TcpConnection::setZeroCopyThreshold(size_t bytes) {
+    loop_->runInLoop(std::bind(&TcpConnection::setZeroCopyThresholdInLoop, shared_from_this(), bytes));
+}
+
+void TcpConnection::setZeroCopyThresholdInLoop(size_t bytes) {
+    if (bytes > 0 && !socket_.setZeroCopy(true)) {
+        // 内核不支持SO_ZEROCOPY(4.14以下)，继续使用普通发送
+        LOG_ERROR("TcpConnection::setZeroCopyThreshold SO_ZEROCOPY unsupported, errno = %d \n", errno);
+        bytes = 0;
+    }
+    zeroCopyThreshold_.store(bytes, std::memory_order_relaxed);
+}
+
+// 记录write排在outputBuffer_的哪个位置之后，保证与send的数据按调用顺序发出
+void TcpConnection::queuePendingWrite(PendingWrite& write) {
+    write.bufferMark = outputBuffer_.totalRetrieved() + outputBuffer_.readableBytes();
+    pendingWrites_.push_back(std::move(write));
+    checkBackpressure();
+    if (!channel_.isWriting()) {
+        channel_.enableWriting();
+    }
+}
+
+// 即将有appending字节进入outputBuffer_，跨过高水位时通知用户
+void TcpConnection::checkHighWaterMark(size_t appending) {
+    // 目前发送缓冲区剩余的待发送数据的长度
+    size_t oldLen = outputBuffer_.readableBytes();
+    if (oldLen + appending >= highWaterMark_
+        && oldLen < highWaterMark_
+        && highWaterMarkCallback_) {
+        loop_->queueInLoop(
+            std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + appending)
+        );
+    }
+}
+
+// 数据已进入outputBuffer_，等待poller通知可写
+void TcpConnection::queueOutput() {
+    updateBufferBytes();
+    checkBackpressure();
+    if (autoCork_) {
+        if (!flushScheduled_) {
+            flushScheduled_ = true;
+            loop_->runAfterDispatch(std::bind(&TcpConnection::flushCorked, shared_from_this()));
+        }
+    }
+    else if (!channel_.isWriting()) {
+        channel_.enableWriting(); // 这里一定要注册channel的写事件，否则poller不会给channel通知epollout
+    }
+}
+
+// 写合并模式下，本轮所有send追加的数据在这里一次writev发出
+void TcpConnection::flushCorked() {
+    flushScheduled_ = false;
+    if (state_ == kDisconnected || channel_.isWriting()) {
+        return; // 已经在等待EPOLLOUT，由handleWrite继续发送
+    }
+
+    int savedErrno = 0;
+    ssize_t n = writeOutput(&savedErrno);
+    if (n < 0 && savedErrno != EAGAIN && savedErrno != EWOULDBLOCK) {
+        LOG_ERROR("TcpConnection::flushCorked errno = %d, closing \n", savedErrno);
+        forceCloseInLoop();
+        return;
+    }
+    if (n > 0) {
+        touchIdle();
+    }
+    updateBufferBytes();
+    checkBackpressure();
+
+    if (outputBuffer_.readableBytes() > 0 || !pendingWrites_.empty()) {
+        channel_.enableWriting();
+    }
+    else {
+        // 已经在分发之后执行，直接回调，不再绕一圈queueInLoop
+        if (writeCompleteCallback_) {
+            writeCompleteCallback_(shared_from_this());
+        }
+        if (state_ == kDisconnecting) {
+            shutdownInLoop();
+        }
+    }
+}
+
+void TcpConnection::startRead() {
+    loop_->runInLoop(std::bind(&TcpConnection::startReadInLoop, shared_from_this()));
+}
+
+void TcpConnection::stopRead() {
+    loop_->runInLoop(std::bind(&TcpConnection::stopReadInLoop, shared_from_this()));
+}
+
+void TcpConnection::startReadInLoop() {
+    if (state_ == kConnected && (!reading_ || !channel_.isReading())) {
+        channel_.enableReading();
+        reading_ = true;
+        // 边沿触发时暂停前没读完的数据不会再有通知，而且同一轮内的stop/start在poller中
+        // 会合并成没有变化，连一次EPOLL_CTL_MOD带来的通知也没有，所以主动再读一次
+        if (channel_.edgeTriggered()) {
+            loop_->queueInLoop(std::bind(&TcpConnection::resumeRead, shared_from_this()));
+        }
+    }
+}
+
+void TcpConnection::stopReadInLoop() {
+    if (reading_ || channel_.isReading()) {
+        channel_.disableReading();
+        reading_ = false;
+    }
+}
+
+void TcpConnection::setBackpressure(const TcpConnectionPtr& source, size_t highWaterMark, size_t lowWaterMark) {
+    loop_->runInLoop(std::bind(&TcpConnection::setBackpressureInLoop,
+                                shared_from_this(), source, highWaterMark, lowWaterMark));
+}
+
+void TcpConnection::setBackpressureInLoop(const TcpConnectionPtr& source, size_t highWaterMark, size_t lowWaterMark) {
+    // 解除旧的关联前，先恢复被暂停的source
+    TcpConnectionPtr old = backpressureSource_.lock();
+    if (old && sourcePaused_) {
+        old->startRead();
+    }
+    sourcePaused_ = false;
+
+    backpressureSource_ = source;
+    backpressureHigh_ = highWaterMark;
+    backpressureLow_ = std::min(lowWaterMark, highWaterMark);
+    checkBackpressure();
+}
+
+// 待发送的数据量变化后调用，越过水位线时暂停或恢复source的读取
+void TcpConnection::checkBackpressure() {
+    if (backpressureHigh_ == 0) {
+        return;
+    }
+    TcpConnectionPtr source = backpressureSource_.lock();
+    if (!source) {
+        return;
+    }
+    // sendfile和零拷贝排队的数据不在outputBuffer_中，也要算进去
+    size_t pending = outputBuffer_.readableBytes();
+    for (const PendingWrite& write : pendingWrites_) {
+        pending += write.remaining;
+    }
+    if (!sourcePaused_ && pending >= backpressureHigh_) {
+        sourcePaused_ = true;
+        source->stopRead();
+    }
+    else if (sourcePaused_ && (pending <= backpressureLow_ || state_ == kDisconnected)) {
+        sourcePaused_ = false;
+        source->startRead();
+    }
+}
+
+void TcpConnection::forceClose() {
+    if (state_ == kConnected || state_ == kDisconnecting) {
+        setState(kDisconnecting);
+        loop_->queueInLoop(
+            std::bind(&TcpConnection::forceCloseInLoop, shared_from_this())
+        );
+    }
+}
+
+void TcpConnection::forceCloseInLoop() {
+    if (state_ == kConnected || state_ == kDisconnecting) {
+        handleClose();
+    }
+}
+
+void TcpConnection::onIdleTimeout(TimingWheel::Node* node) {
+    TcpConnection* conn = static_cast<TcpConnection*>(node);
+    LOG_INFO("TcpConnection::onIdleTimeout [%s] idle for %d seconds \n",
+            conn->name_.c_str(), conn->idleTimeoutSec_);
+    conn->forceClose();
+}
+
+void TcpConnection::touchIdle() {
+    if (idleTimeoutSec_ > 0) {
+        loop_->timingWheel()->touch(this);
     }
 }
 
 void TcpConnection::shutdownInLoop() {
-    if (!channel_->isWriting()) {   // 说明outputBuffer的数据已经全部发送完成
-        socket_->shutdownWrite(); // 关闭写端
+    // 说明outputBuffer的数据已经全部发送完成；写合并模式下还要等待未flush的数据
+    if (!channel_.isWriting() && outputBuffer_.readableBytes() == 0 && pendingWrites_.empty()) {
+        socket_.shutdownWrite(); // 关闭写端
     }
 }
 
@@ -140,8 +546,14 @@ void TcpConnection::shutdownInLoop() {
 // 连接建立
 void TcpConnection::connectEstablished() {
     setState(kConnected);
-    channel_->tie(shared_from_this());
-    channel_->enableReading(); // 向poller注册channel的读事件
+    channel_.tie(shared_from_this());
+    channel_.enableReading(); // 向poller注册channel的读事件
+
+    updateBufferBytes();
+    reclaimId_ = loop_->addReclaimCallback(std::bind(&TcpConnection::reclaimBuffers, this));
+    if (idleTimeoutSec_ > 0) {
+        loop_->timingWheel()->add(this, idleTimeoutSec_, &TcpConnection::onIdleTimeout);
+    }
 
     // 新连接建立，执行回调
     connectionCallback_(shared_from_this()); 
@@ -151,37 +563,84 @@ void TcpConnection::connectEstablished() {
 void TcpConnection::connectDestory() {
     if (state_ == kConnected) {
         setState(kDisconnected);
-        channel_->disableAll();
+        channel_.disableAll();
         connectionCallback_(shared_from_this());
     }
-    channel_->remove(); // 把channel 从 poller中删除
+    channel_.remove(); // 把channel 从 poller中删除
+    checkBackpressure();    // 没有经过handleClose就销毁时，也要恢复被暂停的source
+
+    if (idleTimeoutSec_ > 0) {
+        loop_->timingWheel()->remove(this);
+    }
+
+    if (reclaimId_ >= 0) {
+        loop_->removeReclaimCallback(reclaimId_);
+        reclaimId_ = -1;
+    }
 }
 
 
 void TcpConnection::handleRead(Timestamp receiveTime) {
-    int savedErrno = 0;
-    ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
-    if (n > 0) {
-        messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
-    }
-    else if (n == 0) {
-        handleClose();
+    // 水平触发每次事件只读一次；边沿触发不读到EAGAIN就不会再收到通知，所以循环读取
+    const bool edgeTriggered = channel_.edgeTriggered();
+    size_t total = 0;
+    for (;;) {
+        int savedErrno = 0;
+        // 借用loop的临时接收区，读取的上限由最近几次的读取量决定
+        size_t extraLen = std::min(recvSizer_.guess(), EventLoop::kRecvScratchSize);
+        ssize_t n = inputBuffer_.readFd(channel_.fd(), &savedErrno, loop_->recvScratch(), extraLen);
+        if (n > 0) {
+            recvSizer_.record(n);
+            bufferActive_ = true;
+            touchIdle();
+            inputPeak_ = std::max(inputPeak_, inputBuffer_.readableBytes());
+            messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+            updateBufferBytes();
+
+            // 回调中可能关闭了连接或者暂停了读取
+            if (!edgeTriggered || state_ == kDisconnected || !reading_) {
+                return;
+            }
+            total += n;
+            if (total >= kEdgeReadBudget) {
+                // socket里可能还有数据，但不会再有新的通知，排到本轮的回调里继续读
+                loop_->queueInLoop(std::bind(&TcpConnection::resumeRead, shared_from_this()));
+                return;
+            }
+        }
+        else if (n == 0) {
+            handleClose();
+            return;
+        }
+        else {
+            if (edgeTriggered && (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK)) {
+                return; // 已经读空
+            }
+            errno = savedErrno;
+            LOG_ERROR("TcpConnection:: handleRead");
+            handleError();
+            return;
+        }
     }
-    else {
-        errno = savedErrno;
-        LOG_ERROR("TcpConnection:: handleRead");
-        handleError();
+}
+
+void TcpConnection::resumeRead() {
+    if (state_ != kDisconnected && reading_ && channel_.isReading()) {
+        handleRead(loop_->pollReturnTime());
     }
 }
 
 void TcpConnection::handleWrite() {
-    if (channel_->isWriting()) {
+    if (channel_.isWriting()) {
         int savedErrno = 0;
-        ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno);
+        ssize_t n = writeOutput(&savedErrno);
         if (n > 0) {
-            outputBuffer_.retrieve(n);
-            if (outputBuffer_.readableBytes() == 0) {
-                channel_->disableWriting();
+            bufferActive_ = true;
+            touchIdle();
+            updateBufferBytes();
+            checkBackpressure();
+            if (outputBuffer_.readableBytes() == 0 && pendingWrites_.empty()) {
+                channel_.disableWriting();
                 if (writeCompleteCallback_) {
                     // 唤醒loop_对应的线程，执行回调
                     loop_->queueInLoop(
@@ -192,35 +651,204 @@ void TcpConnection::handleWrite() {
                 }
             }
         }
+        else if (n < 0 && savedErrno != EAGAIN && savedErrno != EWOULDBLOCK) {
+            // 包括文件或payload没能完整发出的情况，不能再继续发送后面的数据
+            LOG_ERROR("TcpConnection::handleWrite errno = %d, closing \n", savedErrno);
+            forceCloseInLoop();
+        }
+    }
+    else {
+        LOG_ERROR("TcpConnection fd = %d is down, no more writing \n", channel_.fd());
+    }
+}
+
+// 按照入队顺序依次写出outputBuffer_中的数据和待发送的文件，直到全部写完或者EAGAIN
+// 返回写出的总字节数，一个字节都没写出且出错时返回-1
+// 文件或payload发送失败时总是返回-1，调用方需要断开连接
+ssize_t TcpConnection::writeOutput(int* savedErrno) {
+    ssize_t total = 0;
+    while (!pendingWrites_.empty()) {
+        PendingWrite& write = pendingWrites_.front();
+
+        // 先写出排在它前面的缓冲区数据
+        size_t before = static_cast<size_t>(write.bufferMark - outputBuffer_.totalRetrieved());
+        if (before > 0) {
+            ssize_t n = outputBuffer_.writeFd(channel_.fd(), savedErrno, before);
+            if (n > 0) {
+                total += n;
+            }
+            if (n < static_cast<ssize_t>(before)) {
+                return total > 0 ? total : n;
+            }
+        }
+
+        ssize_t n = writePending(write);
+        if (n > 0) {
+            total += n;
+            if (write.remaining > 0) {
+                return total;   // 内核发送缓冲区已满
+            }
+        }
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            *savedErrno = errno;
+            return total > 0 ? total : n;
+        }
         else {
-            LOG_ERROR("TcpConnection::handleWrite");
+            // n == 0说明文件比声明的短，其他错误也无法继续
+            *savedErrno = n == 0 ? EIO : errno;
+            LOG_ERROR("TcpConnection::writeOutput fd = %d errno = %d \n", write.fd, *savedErrno);
+            return -1;
+        }
+        pendingWrites_.pop_front();
+    }
+
+    // writeFd内部循环writev，直到发送完或者EAGAIN，并且已经retrieve了写出的数据
+    if (outputBuffer_.readableBytes() > 0) {
+        ssize_t n = outputBuffer_.writeFd(channel_.fd(), savedErrno);
+        if (n > 0) {
+            total += n;
         }
+        else if (total == 0) {
+            return n;
+        }
+    }
+    return total;
+}
+
+// 发送一项不经过outputBuffer_的数据，返回本次写出的字节数
+ssize_t TcpConnection::writePending(PendingWrite& write) {
+    ssize_t n = 0;
+    if (!write.payload) {
+        // sendfile由内核直接把文件页发到socket，不经过用户态
+        n = ::sendfile(channel_.fd(), write.fd, &write.offset, write.remaining);
     }
     else {
-        LOG_ERROR("TcpConnection fd = %d is down, no more writing \n", channel_->fd());
+        const char* data = write.payload->data() + write.offset;
+        n = ::send(channel_.fd(), data, write.remaining, MSG_ZEROCOPY);
+        if (n > 0) {
+            write.zeroCopied = true;
+            write.lastSeq = zeroCopyNextSeq_++;
+        }
+        else if (n < 0 && errno == ENOBUFS) {
+            // 等待完成通知的页超过了optmem限制，这一段退化为普通拷贝发送，不占用序号
+            n = ::send(channel_.fd(), data, write.remaining, 0);
+        }
+        if (n > 0 && static_cast<size_t>(n) == write.remaining && write.zeroCopied) {
+            // 全部交给内核之后，payload还要保留到内核通知最后一次零拷贝发送完成为止
+            // 全程都是拷贝发送的payload内核不再引用，不用等
+            ZeroCopyInflight inflight;
+            inflight.lastSeq = write.lastSeq;
+            inflight.payload = write.payload;
+            zeroCopyInflight_.push_back(std::move(inflight));
+        }
+    }
+    if (n > 0) {
+        write.offset += n;
+        write.remaining -= n;
     }
+    return n;
+}
+
+// 从socket的错误队列中读取MSG_ZEROCOPY的完成通知，释放内核不再引用的payload
+// 返回是否读到了通知
+bool TcpConnection::reapZeroCopyCompletions() {
+    bool reaped = false;
+    for (;;) {
+        char control[128];
+        struct msghdr msg;
+        ::bzero(&msg, sizeof msg);
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof control;
+
+        if (::recvmsg(channel_.fd(), &msg, MSG_ERRQUEUE) < 0) {
+            break;  // EAGAIN: 错误队列已读空
+        }
+        for (struct cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm)) {
+            if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR)
+                || (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))) {
+                continue;
+            }
+            struct sock_extended_err* serr = reinterpret_cast<struct sock_extended_err*>(CMSG_DATA(cm));
+            if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+                continue;
+            }
+            reaped = true;
+            // [ee_info, ee_data]区间内的发送都已完成，通知按序号递增到达
+            uint32_t hi = serr->ee_data;
+            if (static_cast<int32_t>(hi + 1 - zeroCopyAckedSeq_) > 0) {
+                zeroCopyAckedSeq_ = hi + 1;
+            }
+            while (!zeroCopyInflight_.empty()
+                    && static_cast<int32_t>(zeroCopyInflight_.front().lastSeq - hi) <= 0) {
+                zeroCopyInflight_.pop_front();
+            }
+        }
+    }
+    return reaped;
 }
 
 // 底层的channel poller=>channel::closeCallback_ => TcpConnection::handleClose
 void TcpConnection::handleClose() {
-    LOG_INFO("fd = %d state = %d \n", channel_->fd(), (int)state_);
+    LOG_INFO("fd = %d state = %d \n", channel_.fd(), (int)state_);
     setState(kDisconnected);
-    channel_->disableAll();
+    channel_.disableAll();
+    checkBackpressure();    // 本连接不再发送，恢复被暂停的source
+    if (idleTimeoutSec_ > 0) {
+        loop_->timingWheel()->remove(this);
+    }
 
     TcpConnectionPtr connPtr(shared_from_this());
     connectionCallback_(connPtr); // 执行连接关闭的回调
     closeCallback_(connPtr); // 关闭连接的回调, 由TcpServer执行TcpServer::removeConnectiond
 }
 
+void TcpConnection::reclaimBuffers() {
+    if (!bufferActive_) {
+        // 整个回收周期都没有读写，把空闲的存储全部还给系统，下次读写时再分配
+        if (inputBuffer_.readableBytes() == 0) {
+            inputBuffer_.releaseStorage();
+        }
+        else {
+            inputBuffer_.shrink(0);
+        }
+    }
+    else if (inputBuffer_.internalCapacity() > 2 * (Buffer::kCheapPrepend + Buffer::kInitialSize)
+            && inputPeak_ * 4 < inputBuffer_.internalCapacity()) {
+        // 突发流量把缓冲区撑大之后，用量长期不到四分之一，收缩回初始大小附近
+        inputBuffer_.shrink(std::max(inputPeak_, static_cast<size_t>(Buffer::kInitialSize)));
+    }
+    // outputBuffer_的块发完即还给池，不需要单独处理
+
+    bufferActive_ = false;
+    inputPeak_ = inputBuffer_.readableBytes();
+    updateBufferBytes();
+}
+
+void TcpConnection::updateBufferBytes() {
+    int64_t bytes = static_cast<int64_t>(inputBuffer_.internalCapacity() + outputBuffer_.internalCapacity());
+    if (bytes != reportedBufferBytes_) {
+        loop_->addBufferBytes(bytes - reportedBufferBytes_);
+        reportedBufferBytes_ = bytes;
+    }
+}
+
 void TcpConnection::handleError() {
+    // 零拷贝的完成通知也是通过EPOLLERR上报的，读空错误队列后如果socket本身没有错误就直接返回
+    // 只要还有没收到通知的零拷贝发送就要读，包括payload只发出一部分、还不在zeroCopyInflight_里的情况，
+    // 阈值也可能已经被改成0，否则EPOLLERR会一直触发
+    bool reaped = zeroCopyAckedSeq_ != zeroCopyNextSeq_ && reapZeroCopyCompletions();
+
     int optVal;
     socklen_t optlen = sizeof optVal;
     int err = 0;
-    if (::getsockopt(channel_->fd(), SOL_SOCKET, SO_ERROR, &optVal, &optlen) < 0) {
+    if (::getsockopt(channel_.fd(), SOL_SOCKET, SO_ERROR, &optVal, &optlen) < 0) {
         err = errno;
     }
     else {
         err = optVal;
     }
+    if (reaped && err == 0) {
+        return;
+    }
     LOG_ERROR("TcpConnection::handleError name:%s - SO_ERROR: %d \n", name_.c_str(), err);
 }
\ No newline at end of file
@@ -2,24 +2,30 @@
 
 #include "nocopyable.h"
 #include "Buffer.h"
+#include "ChainBuffer.h"
+#include "AdaptiveRecvSizer.h"
 #include "InetAddress.h"
 #include "Callbacks.h"
 #include "Timestamp.h"
+#include "Socket.h"
+#include "Channel.h"
+#include "TimingWheel.h"
 
 #include <memory>
 #include <string>
 #include <atomic>
+#include <deque>
+#include <sys/types.h>
 
-class Channel;
 class EventLoop;
-class Socket;
 
 /*
     TcpServer => Acceptor => 有一个新用户连接，通过accept拿到connfd =>
         TcpConnection设置回调 => Channel => Poller => Channel的回调操作
 */
 
-class TcpConnection: nocopyable, public std::enable_shared_from_this<TcpConnection> {
+// 私有继承时间轮节点，空闲超时不需要额外分配内存，超时回调里也能直接转换回连接对象
+class TcpConnection: nocopyable, private TimingWheel::Node, public std::enable_shared_from_this<TcpConnection> {
 public:
     TcpConnection(EventLoop* loop,
                     const std::string& name,
@@ -35,10 +41,52 @@ public:
 
     bool connected() const { return state_ == kConnected; };
 
-    // 发送数据
+    // 发送数据，在非loop线程调用时，数据会先拷贝或移动到投递给loop的回调中
     void send(const std::string& buf);
+    void send(std::string&& buf);
+    void send(const void* data, size_t len);
+    // 发送buf中的全部可读数据，未能立即写出的部分直接交换进outputBuffer_，不拷贝
+    // 返回后buf被清空
+    void send(Buffer* buf);
+    // 使用sendfile(2)发送文件fd中从offset开始的len个字节，与send的数据按调用顺序发出
+    // 全部发送完成后回调writeCompleteCallback_；fd由调用方持有，需保证在此之前不被关闭
+    void sendFile(int fd, off_t offset, size_t len);
+
+    // 零拷贝发送：payload不少于阈值时使用MSG_ZEROCOPY，内核确认发送完成后才释放对payload的引用
+    // 调用方交出payload后不能再修改它；未开启零拷贝或payload小于阈值时退化为普通send
+    void sendZeroCopy(const ZeroCopyPayload& payload);
+    // 设置零拷贝阈值并在socket上开启SO_ZEROCOPY，0表示关闭；
+    // 开启后send(std::string&&)超过阈值的payload也会走零拷贝
+    void setZeroCopyThreshold(size_t bytes);
+
+    // 自动写合并：开启后send只追加到outputBuffer_，在loop本轮事件分发结束后
+    // 用一次writev统一发出，减少系统调用和小包；需要在loop线程中调用（如连接回调中）
+    void setAutoCork(bool on) { autoCork_ = on; };
+    bool autoCork() const { return autoCork_; };
+
+    // 暂停/恢复从socket读数据，可以在任意线程调用
+    void startRead();
+    void stopRead();
+    bool isReading() const { return reading_; };
+
+    // 读端背压：把source的读取和本连接的发送缓冲区关联起来，
+    // outputBuffer_超过highWaterMark时让source暂停读取，回落到lowWaterMark以下时恢复，
+    // 用于代理等快生产者、慢消费者的场景，保证内存有界；source传空指针表示解除关联
+    void setBackpressure(const TcpConnectionPtr& source, size_t highWaterMark, size_t lowWaterMark);
+
+    // 空闲超时：连接建立后seconds秒内没有任何读写则强制关闭，0表示不限制
+    // 需要在connectEstablished之前设置，见TcpServer::setIdleTimeout
+    void setIdleTimeout(int seconds) { idleTimeoutSec_ = seconds; };
+
+    // 边沿触发模式：每次可读事件一直读到EAGAIN，单次事件最多读kEdgeReadBudget字节
+    // 需要在connectEstablished之前设置，见TcpServer::setEdgeTriggered
+    void setEdgeTriggered(bool on) { channel_.setEdgeTriggered(on); };
+    bool edgeTriggered() const { return channel_.edgeTriggered(); };
+
     // 关闭连接
     void shutdown();
+    // 不等待发送缓冲区，直接关闭连接，可以在任意线程调用
+    void forceClose();
 
     void setConnectionCallback(const ConnectionCallback& cb) {
         connectionCallback_ = cb;
@@ -66,23 +114,59 @@ public:
     void connectDestory();
 private:
     enum StateE {kDisconnected, kConnecting, kConnected, kDisconnecting};
+    struct PendingWrite;
     void setState(StateE state) { state_ = state; };
 
     void handleRead(Timestamp receiveTime);
+    // 边沿触发时读满预算后，在本轮其他事件处理完之后接着读
+    void resumeRead();
     void handleWrite();
     void handleClose();
     void handleError();
 
     void sendInLoop(const void* message, size_t len);
+    void sendStringInLoop(const std::string& message);
+    void sendBufferInLoop(Buffer& buf);
+    size_t writeDirectly(const void* data, size_t len, bool* faultError);
+    void checkHighWaterMark(size_t appending);
+    void queueOutput();
+    void flushCorked();
+    void sendFileInLoop(int fd, off_t offset, size_t len);
+    void sendZeroCopyInLoop(const ZeroCopyPayload& payload);
+    void setZeroCopyThresholdInLoop(size_t bytes);
+    void queuePendingWrite(PendingWrite& write);
+    ssize_t writeOutput(int* savedErrno);
+    ssize_t writePending(PendingWrite& write);
+    bool reapZeroCopyCompletions();
     void shutdownInLoop();
+    void forceCloseInLoop();
+    // 时间轮的超时回调
+    static void onIdleTimeout(TimingWheel::Node* node);
+    // 每次成功读写后调用，刷新时间轮中记录的最近活跃时间
+    void touchIdle();
+    void startReadInLoop();
+    void stopReadInLoop();
+    void setBackpressureInLoop(const TcpConnectionPtr& source, size_t highWaterMark, size_t lowWaterMark);
+    void checkBackpressure();
+
+    // send(Buffer*)时剩余数据不少于该值才把Buffer整个交换进outputBuffer_
+    static const size_t kMinAdoptBytes = 4096;
+    // 边沿触发时一次可读事件最多读取的字节数，保证其他连接不被饿死
+    static const size_t kEdgeReadBudget = 256 * 1024;
+
+    // 由loop周期性调用：空闲连接释放缓冲区，长期低用量的缓冲区收缩回初始大小
+    void reclaimBuffers();
+    // 把缓冲区占用的变化量同步到loop_的统计中
+    void updateBufferBytes();
 
     EventLoop* loop_; // 绝不是baseloop，因为TCP Connection都是在subloop中被管理的
     const std::string name_;
     std::atomic_int state_;
     bool reading_;
 
-    std::unique_ptr<Socket> socket_;
-    std::unique_ptr<Channel> channel_;
+    // 直接作为成员，和连接对象一起分配，省掉两次堆分配
+    Socket socket_;
+    Channel channel_;
 
     const InetAddress localAddr_;
     const InetAddress peerAddr_;
@@ -95,6 +179,46 @@ private:
 
     size_t highWaterMark_;
 
+    std::weak_ptr<TcpConnection> backpressureSource_;  // 被本连接限流的连接
+    size_t backpressureHigh_;
+    size_t backpressureLow_;
+    bool sourcePaused_;     // 是否已经让source暂停读取
+
+    AdaptiveRecvSizer recvSizer_;  // 预测下一次readv的大小
     Buffer inputBuffer_;
-    Buffer outputBuffer_;
+    ChainBuffer outputBuffer_;  // 链式发送缓冲区，块取自loop_的块池
+
+    // 不经过outputBuffer_发送的数据：sendfile的文件，或者MSG_ZEROCOPY的payload
+    // bufferMark之前的outputBuffer_数据要先于它发出
+    struct PendingWrite {
+        uint64_t bufferMark;    // 以outputBuffer_.totalRetrieved()计数的位置
+        int fd;                 // sendfile的文件
+        off_t offset;           // 文件或payload中下一个要发送的位置
+        size_t remaining;
+        ZeroCopyPayload payload;    // 非空时表示零拷贝发送该payload
+        bool zeroCopied;            // payload是否有某一段是以MSG_ZEROCOPY发出的
+        uint32_t lastSeq;           // zeroCopied时，最后一次零拷贝发送的序号
+    };
+    std::deque<PendingWrite> pendingWrites_;
+
+    // 已经交给内核、等待零拷贝完成通知的payload，lastSeq是它最后一次发送的序号
+    struct ZeroCopyInflight {
+        uint32_t lastSeq;
+        ZeroCopyPayload payload;
+    };
+    std::deque<ZeroCopyInflight> zeroCopyInflight_;
+    bool autoCork_;
+    bool flushScheduled_;       // 本轮是否已经安排了flushCorked
+
+    // 0表示未开启零拷贝；send可能在其他线程读取，只在loop线程中修改
+    std::atomic<size_t> zeroCopyThreshold_;
+    uint32_t zeroCopyNextSeq_;  // 内核为每次MSG_ZEROCOPY发送分配的序号，从0开始递增
+    uint32_t zeroCopyAckedSeq_; // 序号小于它的发送都已收到完成通知，不等于zeroCopyNextSeq_时错误队列里可能有通知
+
+    bool bufferActive_;             // 上次回收以来是否有过读写
+    size_t inputPeak_;              // 上次回收以来inputBuffer_可读数据的峰值
+    int64_t reportedBufferBytes_;   // 已经计入loop_统计的缓冲区字节数
+    int64_t reclaimId_;             // 在loop_中注册的回收回调，-1表示未注册
+
+    int idleTimeoutSec_;            // 0表示不做空闲超时
 };
\ No newline at end of file
@@ -1,9 +1,12 @@
 #include "TcpServer.h"
 #include "Logger.h"
 #include "TcpConnection.h"
+#include "SlabArena.h"
 #include <string.h>
 
 #include <functional>
+#include <future>
+#include <errno.h>
 
 static EventLoop* CheckLoopNotNull(EventLoop* loop) {
     if (loop == nullptr) {
@@ -17,18 +20,29 @@ TcpServer::TcpServer(EventLoop* loop,
                 const std::string &nameArg,
                 Option option)
                 : loop_(CheckLoopNotNull(loop))
+                , listenAddr_(ListenAddr)
                 , ipPort_(ListenAddr.toIpPort())
                 , name_(nameArg)
                 , acceptor_(new Acceptor(loop, ListenAddr, option == kReusePort))
                 , threadPool_(new EventLoopThreadPool(loop, name_))
                 , connectionCallback_()
                 , messageCallback_()
-                , nextConnId_(1) {
+                , started_(0)
+                , nextConnId_(1)
+                , autoCork_(false)
+                , idleTimeoutSec_(0)
+                , edgeTriggered_(false)
+                , shardedAccept_(false)
+                , steerByCpu_(false) {
     acceptor_->setNewConnectionCallback(std::bind(&TcpServer::newConnection, this, 
                                         std::placeholders::_1, std::placeholders::_2));
 }
 
 TcpServer::~TcpServer() {
+    for (std::unique_ptr<Shard> &shard: shards_) {
+        stopShard(shard.get());
+    }
+
     for (auto &item: connections_) {
         // 出函数体即可自动释放new出来的TcpConnection对象
         TcpConnectionPtr conn(item.second);
@@ -43,13 +57,69 @@ void TcpServer::setThreadNum(int numThreads) {
     threadPool_->setThreadNum(numThreads);
 }
 
+void TcpServer::setBusyPoll(int index, int spinMicros, int socketBusyPollMicros) {
+    threadPool_->setBusyPoll(index, spinMicros, socketBusyPollMicros);
+}
+
+void TcpServer::setPollerBackend(Poller::Backend backend) {
+    threadPool_->setPollerBackend(backend);
+}
+
 void TcpServer::start() {
     if (started_++ == 0) {  // 防止一个TcpServer被start多次
         threadPool_->start(threadInitCallback_);    // 启动底层的线程池
-        loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));    // 启动循环，用于listen
+        if (shardedAccept_) {
+            // 要先销毁构造时创建的acceptor，它的channel属于mainloop，放到mainloop线程里做
+            loop_->runInLoop(std::bind(&TcpServer::startShards, this));
+        }
+        else {
+            loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));    // 启动循环，用于listen
+        }
+    }
+}
+
+// 在mainloop线程里执行
+void TcpServer::startShards() {
+    // 构造时创建的acceptor可能没有开SO_REUSEPORT，先关掉让出端口
+    acceptor_.reset();
+
+    std::vector<EventLoop*> loops = threadPool_->getAllLoops();
+    for (size_t i = 0; i < loops.size(); ++i) {
+        std::unique_ptr<Shard> shard(new Shard);
+        shard->loop = loops[i];
+        shard->index = static_cast<int>(i);
+        shard->nextConnId = 1;
+        shard->acceptor.reset(new Acceptor(loops[i], listenAddr_, true));
+        shard->acceptor->setNewConnectionCallback(std::bind(&TcpServer::newShardConnection, this,
+                                                  shard.get(), std::placeholders::_1, std::placeholders::_2));
+        // 在这里依次listen，保证SO_REUSEPORT组内第i个socket属于第i个loop
+        shard->acceptor->listenSocket();
+        shards_.push_back(std::move(shard));
+    }
+
+    if (steerByCpu_ && !shards_[0]->acceptor->setReusePortCpuSteering(static_cast<int>(shards_.size()))) {
+        LOG_ERROR("TcpServer::startShards [%s] SO_ATTACH_REUSEPORT_CBPF failed:%d \n", name_.c_str(), errno);
+    }
+
+    for (std::unique_ptr<Shard> &shard: shards_) {
+        shard->loop->runInLoop(std::bind(&Acceptor::listen, shard->acceptor.get()));
     }
 }
 
+// acceptor和连接都属于shard的loop，要在那个线程里销毁，等它完成后再返回
+void TcpServer::stopShard(Shard* shard) {
+    std::promise<void> done;
+    shard->loop->runInLoop([shard, &done]() {
+        shard->acceptor.reset();
+        for (auto &item: shard->connections) {
+            item.second->connectDestory();
+        }
+        shard->connections.clear();
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
 // 有一个新的客户端连接，acceptor会执行回调操作
 void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr) {
     EventLoop* ioLoop = threadPool_->getNextLoop(); // 使用轮询算法
@@ -57,6 +127,38 @@ void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr) {
     snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_);
     ++nextConnId_; // 仅在mainloop的线程中使用
     std::string connName = name_ + buf;
+
+    TcpConnectionPtr conn = createConnection(ioLoop, connName, sockfd, peerAddr);
+    connections_[connName] = conn;
+
+    // 设置如何关闭连接的回调
+    conn->setCloseCallback(
+        std::bind(&TcpServer::removeConnection, this, std::placeholders::_1)
+    );
+
+    /* 直接调用 */ 
+    ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+}
+
+// 分片模式下由shard自己的loop调用，连接直接在当前线程建立
+void TcpServer::newShardConnection(Shard* shard, int sockfd, const InetAddress& peerAddr) {
+    char buf[64] = {0};
+    snprintf(buf, sizeof buf, "-%s#%d-%d", ipPort_.c_str(), shard->index, shard->nextConnId);
+    ++shard->nextConnId;
+    std::string connName = name_ + buf;
+
+    TcpConnectionPtr conn = createConnection(shard->loop, connName, sockfd, peerAddr);
+    shard->connections[connName] = conn;
+    conn->setCloseCallback(
+        std::bind(&TcpServer::removeShardConnection, this, shard, std::placeholders::_1)
+    );
+    conn->connectEstablished();
+}
+
+TcpConnectionPtr TcpServer::createConnection(EventLoop* ioLoop,
+                                             const std::string& connName,
+                                             int sockfd,
+                                             const InetAddress& peerAddr) {
     LOG_INFO("TcpServer::newConnection [%s] - new connection [%s] from %s \n",
                 name_.c_str(), connName.c_str(), peerAddr.toIpPort().c_str());
 
@@ -70,28 +172,23 @@ void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr) {
     InetAddress localAddr(local);
 
     // 通过连接成功的sockfd，创建TcpConnection连接对象
-    TcpConnectionPtr conn(new TcpConnection(
+    // 连接对象和shared_ptr的控制块一起从ioLoop的arena中分配
+    TcpConnectionPtr conn = std::allocate_shared<TcpConnection>(
+                                ArenaAllocator<TcpConnection>(ioLoop->arena()),
                                 ioLoop,
                                 connName,
                                 sockfd,
                                 localAddr,
-                                peerAddr
+                                peerAddr);
 
-    ));
-    connections_[connName] = conn;
-    
     // 下面的回调皆是用户设置 顺序为：TcpServer => TcpConnection => Channel => Poller => notify channel
     conn->setConnectionCallback(connectionCallback_);
     conn->setMessageCallback(messageCallback_);
     conn->setWriteCompleteCallback(writeCompleteCallback_);
-
-    // 设置如何关闭连接的回调
-    conn->setCloseCallback(
-        std::bind(&TcpServer::removeConnection, this, std::placeholders::_1)
-    );
-
-    /* 直接调用 */ 
-    ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+    conn->setAutoCork(autoCork_);
+    conn->setIdleTimeout(idleTimeoutSec_);
+    conn->setEdgeTriggered(edgeTriggered_);
+    return conn;
 }
 
 
@@ -109,3 +206,13 @@ void TcpServer::removeConnectionInLoop(const TcpConnectionPtr& conn) {
         std::bind(&TcpConnection::connectDestory, conn)
     );
 }
+
+// 在连接所属的loop中被调用，也就是shard自己的loop
+void TcpServer::removeShardConnection(Shard* shard, const TcpConnectionPtr& conn) {
+    LOG_INFO("TcpServer::removeShardConnection [%s] - connection %s \n",
+        name_.c_str(), conn->name().c_str());
+    shard->connections.erase(conn->name());
+    shard->loop->queueInLoop(
+        std::bind(&TcpConnection::connectDestory, conn)
+    );
+}
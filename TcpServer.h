@@ -10,6 +10,7 @@
 #include <functional>
 #include <unordered_map>
 #include <string>
+#include <vector>
 
 // 对外的服务器编程使用的类
 class TcpServer : nocopyable{
@@ -36,9 +37,34 @@ public:
 
     void setWriteCompleteCallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; };
 
+    // 新连接是否开启自动写合并，见TcpConnection::setAutoCork
+    void setAutoCork(bool on) { autoCork_ = on; };
+
+    // 空闲连接超时，seconds秒内没有读写的连接会被强制关闭，0表示不限制
+    // 由各subloop的时间轮管理，最长约4.5小时
+    void setIdleTimeout(int seconds) { idleTimeoutSec_ = seconds; };
+
+    // 新连接是否使用边沿触发，见TcpConnection::setEdgeTriggered
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; };
+
+    // 让第index个subloop工作在低延迟模式，见EventLoopThreadPool::setBusyPoll
+    void setBusyPoll(int index, int spinMicros, int socketBusyPollMicros = 0);
+
+    // subloop使用的IO复用实现，例如Poller::kIoUring；baseloop由调用方构造EventLoop时指定
+    void setPollerBackend(Poller::Backend backend);
+
     // 设置底层subloop的个数
     void setThreadNum(int numThreads);
 
+    // 分片accept：每个subloop各自持有一个SO_REUSEPORT的监听socket，由内核把新连接分给各个loop，
+    // 连接在接受它的loop里直接建立，不经过baseloop转交
+    // steerByCpu为true时按处理软中断的CPU选择监听socket，第i个subloop的线程应当绑定到第i个CPU上
+    // 需要在start之前调用
+    void setShardedAccept(bool on, bool steerByCpu = false) {
+        shardedAccept_ = on;
+        steerByCpu_ = steerByCpu;
+    }
+
     // 开启服务器监听
     void start();
 
@@ -46,11 +72,31 @@ private:
     void newConnection(int sockfd, const InetAddress& peerAddr);
     void removeConnection(const TcpConnectionPtr& conn);
     void removeConnectionInLoop(const TcpConnectionPtr& conn);
+    // 创建连接对象并设置好用户回调，closeCallback由调用方设置
+    TcpConnectionPtr createConnection(EventLoop* ioLoop,
+                                      const std::string& connName,
+                                      int sockfd,
+                                      const InetAddress& peerAddr);
 
     using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr>;
 
+    // 分片模式下每个loop一份，只在该loop的线程中访问
+    struct Shard {
+        EventLoop* loop;
+        int index;
+        int nextConnId;
+        std::unique_ptr<Acceptor> acceptor;
+        ConnectionMap connections;
+    };
+
+    void startShards();
+    void stopShard(Shard* shard);
+    void newShardConnection(Shard* shard, int sockfd, const InetAddress& peerAddr);
+    void removeShardConnection(Shard* shard, const TcpConnectionPtr& conn);
+
     EventLoop* loop_;   // baseloop
 
+    const InetAddress listenAddr_;
     const std::string ipPort_;
     const std::string name_;
 
@@ -66,6 +112,12 @@ private:
     std::atomic_int started_;
 
     int nextConnId_;
-
-    ConnectionMap connections_; // 保存所有连接
+    bool autoCork_;
+    int idleTimeoutSec_;
+    bool edgeTriggered_;
+    bool shardedAccept_;
+    bool steerByCpu_;
+
+    ConnectionMap connections_; // 保存所有连接，分片模式下连接保存在各自的shard中
+    std::vector<std::unique_ptr<Shard>> shards_;
 };
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "nocopyable.h"
+#include "Timestamp.h"
+#include "Callbacks.h"
+
+#include <atomic>
+
+// 定时器，记录到期时间、回调以及重复间隔
+class Timer : nocopyable {
+public:
+    Timer(TimerCallback cb, Timestamp when, double interval)
+        : callback_(std::move(cb))
+        , expiration_(when)
+        , interval_(interval)
+        , repeat_(interval > 0.0)
+        , sequence_(++numCreated_) {
+
+    }
+
+    void run() const { callback_(); };
+
+    Timestamp expiration() const { return expiration_; };
+    bool repeat() const { return repeat_; };
+    int64_t sequence() const { return sequence_; };
+
+    // 重复定时器在now的基础上重新计算到期时间
+    void restart(Timestamp now);
+
+    static int64_t numCreated() { return numCreated_; };
+
+private:
+    const TimerCallback callback_;
+    Timestamp expiration_;
+    const double interval_;     // 重复间隔，单位秒
+    const bool repeat_;
+    const int64_t sequence_;    // 全局唯一序号，用于区分地址被复用的Timer
+
+    static std::atomic<int64_t> numCreated_;
+};
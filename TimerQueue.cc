@@ -0,0 +1,173 @@
+#include "TimerQueue.h"
+#include "Timer.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <string.h>
+#include <iterator>
+
+static int createTimerfd() {
+    int timerfd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timerfd < 0) {
+        LOG_FATAL("Failed in timerfd_create:%d \n", errno);
+    }
+    return timerfd;
+}
+
+// 计算距离when还有多久，至少100微秒，避免设置一个已经过去的时间
+static struct timespec howMuchTimeFromNow(Timestamp when) {
+    int64_t microseconds = microSecondsDifference(when, Timestamp::now());
+    if (microseconds < 100) {
+        microseconds = 100;
+    }
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(microseconds / Timestamp::kMicroSecondsPerSecond);
+    ts.tv_nsec = static_cast<long>((microseconds % Timestamp::kMicroSecondsPerSecond) * 1000);
+    return ts;
+}
+
+static void readTimerfd(int timerfd) {
+    uint64_t howmany;
+    ssize_t n = ::read(timerfd, &howmany, sizeof howmany);
+    if (n != sizeof howmany) {
+        LOG_ERROR("TimerQueue::handleRead() reads %ld bytes instead of 8 \n", n);
+    }
+}
+
+static void resetTimerfd(int timerfd, Timestamp expiration) {
+    struct itimerspec newValue;
+    struct itimerspec oldValue;
+    ::memset(&newValue, 0, sizeof newValue);
+    ::memset(&oldValue, 0, sizeof oldValue);
+    newValue.it_value = howMuchTimeFromNow(expiration);
+    if (::timerfd_settime(timerfd, 0, &newValue, &oldValue) < 0) {
+        LOG_ERROR("timerfd_settime error:%d \n", errno);
+    }
+}
+
+TimerQueue::TimerQueue(EventLoop* loop)
+    : loop_(loop)
+    , timerfd_(createTimerfd())
+    , timerfdChannel_(loop, timerfd_)
+    , callingExpiredTimers_(false) {
+    timerfdChannel_.setReadCallback(std::bind(&TimerQueue::handleRead, this));
+    timerfdChannel_.enableReading();
+}
+
+TimerQueue::~TimerQueue() {
+    timerfdChannel_.disableAll();
+    timerfdChannel_.remove();
+    ::close(timerfd_);
+    for (const Entry& timer : timers_) {
+        delete timer.second;
+    }
+}
+
+TimerId TimerQueue::addTimer(TimerCallback cb, Timestamp when, double interval) {
+    Timer* timer = new Timer(std::move(cb), when, interval);
+    loop_->runInLoop(std::bind(&TimerQueue::addTimerInLoop, this, timer));
+    return TimerId(timer, timer->sequence());
+}
+
+void TimerQueue::cancel(TimerId timerId) {
+    loop_->runInLoop(std::bind(&TimerQueue::cancelInLoop, this, timerId));
+}
+
+void TimerQueue::addTimerInLoop(Timer* timer) {
+    bool earliestChanged = insert(timer);
+    if (earliestChanged) {
+        resetTimerfd(timerfd_, timer->expiration());
+    }
+}
+
+void TimerQueue::cancelInLoop(TimerId timerId) {
+    ActiveTimer timer(timerId.timer_, timerId.sequence_);
+    ActiveTimerSet::iterator it = activeTimers_.find(timer);
+    if (it != activeTimers_.end()) {
+        timers_.erase(Entry(it->first->expiration(), it->first));
+        delete it->first;
+        activeTimers_.erase(it);
+    }
+    else if (callingExpiredTimers_) {
+        // 定时器正在执行（可能是重复定时器在回调里取消自己），执行完后不再重新加入
+        cancelingTimers_.insert(timer);
+    }
+}
+
+void TimerQueue::handleRead() {
+    // 直接用本轮poll返回时缓存的时间，不再读一次时钟
+    // 偶尔因为取整差几微秒还没到期的定时器，reset时会重新设置timerfd
+    Timestamp now(loop_->pollReturnTime());
+    // 粗粒度时钟可能比timerfd落后一个jiffy，拿它判断到期会在100微秒的下限上反复重设，
+    // 这时读同一时间轴上的精确时钟
+    const Timestamp::Clock clock = Timestamp::defaultClock();
+    if (clock == Timestamp::kRealtimeCoarse) {
+        now = Timestamp::now(Timestamp::kRealtime);
+    }
+    else if (clock == Timestamp::kMonotonicCoarse) {
+        now = Timestamp::now(Timestamp::kMonotonic);
+    }
+    readTimerfd(timerfd_);
+
+    // 一次唤醒批量处理所有已到期的定时器
+    std::vector<Entry> expired = getExpired(now);
+
+    callingExpiredTimers_ = true;
+    cancelingTimers_.clear();
+    for (const Entry& it : expired) {
+        it.second->run();
+    }
+    callingExpiredTimers_ = false;
+
+    reset(expired, now);
+}
+
+std::vector<TimerQueue::Entry> TimerQueue::getExpired(Timestamp now) {
+    std::vector<Entry> expired;
+    // 哨兵取最大的指针，保证所有到期时间等于now的定时器都在end之前
+    Entry sentry(now, reinterpret_cast<Timer*>(UINTPTR_MAX));
+    TimerList::iterator end = timers_.lower_bound(sentry);
+    std::copy(timers_.begin(), end, std::back_inserter(expired));
+    timers_.erase(timers_.begin(), end);
+
+    for (const Entry& it : expired) {
+        ActiveTimer timer(it.second, it.second->sequence());
+        activeTimers_.erase(timer);
+    }
+    return expired;
+}
+
+void TimerQueue::reset(const std::vector<Entry>& expired, Timestamp now) {
+    for (const Entry& it : expired) {
+        ActiveTimer timer(it.second, it.second->sequence());
+        if (it.second->repeat()
+            && cancelingTimers_.find(timer) == cancelingTimers_.end()) {
+            it.second->restart(now);
+            insert(it.second);
+        }
+        else {
+            delete it.second;
+        }
+    }
+
+    if (!timers_.empty()) {
+        Timestamp nextExpire = timers_.begin()->second->expiration();
+        if (nextExpire.valid()) {
+            resetTimerfd(timerfd_, nextExpire);
+        }
+    }
+}
+
+bool TimerQueue::insert(Timer* timer) {
+    bool earliestChanged = false;
+    Timestamp when = timer->expiration();
+    TimerList::iterator it = timers_.begin();
+    if (it == timers_.end() || when < it->first) {
+        earliestChanged = true;
+    }
+    timers_.insert(Entry(when, timer));
+    activeTimers_.insert(ActiveTimer(timer, timer->sequence()));
+    return earliestChanged;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "nocopyable.h"
+#include "Timestamp.h"
+#include "Callbacks.h"
+#include "Channel.h"
+#include "TimerId.h"
+
+#include <set>
+#include <vector>
+
+class EventLoop;
+class Timer;
+
+/*
+    基于timerfd的定时器队列，每个EventLoop持有一个
+    - 所有定时器按到期时间保存在std::set中，插入、取消都是O(log n)
+    - timerfd只设置为最早到期的时间，到期后一次取出所有已到期的定时器批量执行
+    - addTimer / cancel可以在任意线程调用，实际操作都转到loop线程中进行
+*/
+class TimerQueue : nocopyable {
+public:
+    explicit TimerQueue(EventLoop* loop);
+    ~TimerQueue();
+
+    // interval > 0 时为重复定时器
+    TimerId addTimer(TimerCallback cb, Timestamp when, double interval);
+
+    void cancel(TimerId timerId);
+
+private:
+    using Entry = std::pair<Timestamp, Timer*>;
+    using TimerList = std::set<Entry>;
+    using ActiveTimer = std::pair<Timer*, int64_t>;
+    using ActiveTimerSet = std::set<ActiveTimer>;
+
+    void addTimerInLoop(Timer* timer);
+    void cancelInLoop(TimerId timerId);
+    // timerfd可读时回调
+    void handleRead();
+    // 取出所有已到期的定时器
+    std::vector<Entry> getExpired(Timestamp now);
+    void reset(const std::vector<Entry>& expired, Timestamp now);
+
+    // 返回最早到期的时间是否改变
+    bool insert(Timer* timer);
+
+    EventLoop* loop_;
+    const int timerfd_;
+    Channel timerfdChannel_;
+    TimerList timers_;  // 按到期时间排序
+
+    ActiveTimerSet activeTimers_;   // 按Timer地址排序，与timers_中的定时器一一对应
+    bool callingExpiredTimers_;
+    ActiveTimerSet cancelingTimers_;    // 在执行到期回调期间被取消的定时器
+};
@@ -1,5 +1,114 @@
 #include "Timestamp.h"
 
+#include <atomic>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#if defined(__x86_64__)
+#define MUDUO_HAVE_TSC 1
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+namespace {
+
+std::atomic<int> g_defaultClock(Timestamp::kRealtime);
+
+int64_t readClock(clockid_t id) {
+    struct timespec ts;
+    ::clock_gettime(id, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * Timestamp::kMicroSecondsPerSecond + ts.tv_nsec / 1000;
+}
+
+int64_t readNanos(clockid_t id) {
+    struct timespec ts;
+    ::clock_gettime(id, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 * 1000 + ts.tv_nsec;
+}
+
+// TSC读数到CLOCK_MONOTONIC纳秒的线性换算
+struct TscClock {
+    bool usable;
+    uint64_t baseTsc;
+    int64_t baseNanos;
+    double nanosPerTick;
+};
+
+#ifdef MUDUO_HAVE_TSC
+// CPUID.80000007H:EDX[8]，TSC频率恒定且各核同步才能拿来计时
+bool hasInvariantTsc() {
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007) {
+        return false;
+    }
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx & (1u << 8)) != 0;
+}
+
+// 同一时刻的一对(TSC, 单调时钟纳秒)：前后各读一次TSC夹住clock_gettime取中点，
+// 采样几次取夹得最紧的一次，去掉被中断或调度打断的读数
+void sampleTscPair(uint64_t* tsc, int64_t* nanos) {
+    uint64_t bestWidth = UINT64_MAX;
+    for (int i = 0; i < 5; ++i) {
+        uint64_t before = __rdtsc();
+        int64_t now = readNanos(CLOCK_MONOTONIC);
+        uint64_t after = __rdtsc();
+        if (after - before < bestWidth) {
+            bestWidth = after - before;
+            *tsc = before + (after - before) / 2;
+            *nanos = now;
+        }
+    }
+}
+
+// 睡100ms，用这段时间内TSC和单调时钟各自走过的量算出换算比例
+// 两端读数的误差在几十纳秒以内，比例的相对误差约1e-7，每小时偏差在百微秒以内
+TscClock calibrateTsc() {
+    TscClock clock = {false, 0, 0, 0.0};
+    if (!hasInvariantTsc()) {
+        return clock;
+    }
+    uint64_t startTsc, endTsc;
+    int64_t startNanos, endNanos;
+    sampleTscPair(&startTsc, &startNanos);
+    ::usleep(100 * 1000);
+    sampleTscPair(&endTsc, &endNanos);
+    if (endTsc <= startTsc) {
+        return clock;
+    }
+
+    clock.usable = true;
+    clock.baseTsc = startTsc;
+    clock.baseNanos = startNanos;
+    clock.nanosPerTick = static_cast<double>(endNanos - startNanos) / static_cast<double>(endTsc - startTsc);
+    return clock;
+}
+#else
+TscClock calibrateTsc() {
+    TscClock clock = {false, 0, 0, 0.0};
+    return clock;
+}
+#endif
+
+const TscClock& tscClock() {
+    static const TscClock clock = calibrateTsc();
+    return clock;
+}
+
+int64_t readTsc() {
+#ifdef MUDUO_HAVE_TSC
+    const TscClock& clock = tscClock();
+    if (clock.usable) {
+        int64_t nanos = clock.baseNanos + static_cast<int64_t>(static_cast<double>(__rdtsc() - clock.baseTsc) * clock.nanosPerTick);
+        return nanos / 1000;
+    }
+#endif
+    return readClock(CLOCK_MONOTONIC);
+}
+
+}
+
 Timestamp::Timestamp()
     :microSecondsSinceEpoch_(0) {
 
@@ -11,20 +120,48 @@ Timestamp::Timestamp(int64_t microSecondsSinceEpoch)
     }
 
 Timestamp Timestamp::now() {
-    // time_t ti  = time(NULL);
-    return Timestamp(time(NULL));
+    return now(defaultClock());
+}
+
+Timestamp Timestamp::now(Clock clock) {
+    switch (clock) {
+        case kRealtimeCoarse:
+            return Timestamp(readClock(CLOCK_REALTIME_COARSE));
+        case kMonotonic:
+            return Timestamp(readClock(CLOCK_MONOTONIC));
+        case kMonotonicCoarse:
+            return Timestamp(readClock(CLOCK_MONOTONIC_COARSE));
+        case kTsc:
+            return Timestamp(readTsc());
+        case kRealtime:
+        default:
+            return Timestamp(readClock(CLOCK_REALTIME));
+    }
+}
+
+void Timestamp::setDefaultClock(Clock clock) {
+    if (clock == kTsc) {
+        tscClock(); // 提前校准，避免第一次取时间时睡100ms
+    }
+    g_defaultClock.store(clock, std::memory_order_relaxed);
+}
+
+Timestamp::Clock Timestamp::defaultClock() {
+    return static_cast<Clock>(g_defaultClock.load(std::memory_order_relaxed));
 }
 
 std::string Timestamp::toString() const {
-    char buf[128] = {0};
-
-    tm *tm_time = localtime(&microSecondsSinceEpoch_);
-    snprintf(buf, 128, "%4d/%02d/%02d %02d:%02d:%02d",
-        tm_time->tm_year + 1900,
-        tm_time->tm_mon + 1,
-        tm_time->tm_mday,
-        tm_time->tm_hour,
-        tm_time->tm_min,
-        tm_time->tm_sec);
+    char buf[64];
+
+    time_t seconds = secondsSinceEpoch();
+    struct tm tm_time;
+    ::localtime_r(&seconds, &tm_time);
+    snprintf(buf, sizeof buf, "%4d/%02d/%02d %02d:%02d:%02d",
+        tm_time.tm_year + 1900,
+        tm_time.tm_mon + 1,
+        tm_time.tm_mday,
+        tm_time.tm_hour,
+        tm_time.tm_min,
+        tm_time.tm_sec);
     return buf;
 }
\ No newline at end of file
@@ -2,14 +2,92 @@
 
 #include <iostream>
 #include <string>
+#include <stdint.h>
+#include <time.h>
 
 class Timestamp {
 public:
+    static const int kMicroSecondsPerSecond = 1000 * 1000;
+
+    /*
+        时钟源：
+        - kRealtime：墙上时间，默认值，toString得到的是本地时间
+        - kMonotonic：单调时钟，不受系统改时影响，值是开机以来的时间
+        - *Coarse：对应时钟的粗粒度版本，精度是一个jiffy（通常1~4ms），开销最小
+        - kTsc：直接读TSC，首次使用时对照CLOCK_MONOTONIC校准，值和kMonotonic同一个时间轴，
+          CPU没有不变的TSC时退回kMonotonic
+        只有realtime时钟的时间戳能转换成日期
+    */
+    enum Clock {
+        kRealtime,
+        kRealtimeCoarse,
+        kMonotonic,
+        kMonotonicCoarse,
+        kTsc,
+    };
+
     Timestamp();
     explicit Timestamp(int64_t microSecondsSinceEpoch);
+    // 读默认时钟，EventLoop、定时器都通过它取时间
     static Timestamp now();
+    static Timestamp now(Clock clock);
+    // 切换默认时钟，不同时钟的时间戳不能相互比较，所以必须在创建EventLoop之前设置
+    static void setDefaultClock(Clock clock);
+    static Clock defaultClock();
     std::string toString() const;
+
+    int64_t microSecondsSinceEpoch() const { return microSecondsSinceEpoch_; };
+    time_t secondsSinceEpoch() const {
+        return static_cast<time_t>(microSecondsSinceEpoch_ / kMicroSecondsPerSecond);
+    }
+    bool valid() const { return microSecondsSinceEpoch_ > 0; };
+    static Timestamp invalid() { return Timestamp(); };
 private:
     int64_t microSecondsSinceEpoch_;
 
-};
\ No newline at end of file
+};
+
+inline bool operator<(Timestamp lhs, Timestamp rhs) {
+    return lhs.microSecondsSinceEpoch() < rhs.microSecondsSinceEpoch();
+}
+
+inline bool operator==(Timestamp lhs, Timestamp rhs) {
+    return lhs.microSecondsSinceEpoch() == rhs.microSecondsSinceEpoch();
+}
+
+inline bool operator!=(Timestamp lhs, Timestamp rhs) {
+    return !(lhs == rhs);
+}
+
+inline bool operator>(Timestamp lhs, Timestamp rhs) {
+    return rhs < lhs;
+}
+
+inline bool operator<=(Timestamp lhs, Timestamp rhs) {
+    return !(rhs < lhs);
+}
+
+inline bool operator>=(Timestamp lhs, Timestamp rhs) {
+    return !(lhs < rhs);
+}
+
+// 两个时间点相差的微秒数，high在low之前时为负
+inline int64_t microSecondsDifference(Timestamp high, Timestamp low) {
+    return high.microSecondsSinceEpoch() - low.microSecondsSinceEpoch();
+}
+
+// 两个时间点相差的秒数
+inline double timeDifference(Timestamp high, Timestamp low) {
+    return static_cast<double>(microSecondsDifference(high, low)) / Timestamp::kMicroSecondsPerSecond;
+}
+
+// 返回timestamp之后microseconds微秒的时间点
+inline Timestamp addMicroSeconds(Timestamp timestamp, int64_t microseconds) {
+    return Timestamp(timestamp.microSecondsSinceEpoch() + microseconds);
+}
+
+// 返回timestamp之后seconds秒的时间点
+inline Timestamp addTime(Timestamp timestamp, double seconds) {
+    int64_t delta = static_cast<int64_t>(seconds * Timestamp::kMicroSecondsPerSecond);
+    return Timestamp(timestamp.microSecondsSinceEpoch() + delta);
+}
@@ -0,0 +1,136 @@
+#include "TimingWheel.h"
+
+const uint32_t TimingWheel::kLevel0Bits;
+const uint32_t TimingWheel::kLevel0Slots;
+const uint32_t TimingWheel::kLevel1Slots;
+const uint32_t TimingWheel::kMaxTimeout;
+
+TimingWheel::TimingWheel()
+    : now_(0)
+    , size_(0) {
+    for (Node& head : level0_) {
+        head.prev = head.next = &head;
+    }
+    for (Node& head : level1_) {
+        head.prev = head.next = &head;
+    }
+}
+
+TimingWheel::~TimingWheel() {
+    // 节点由使用方持有，这里只把它们摘下来
+    for (Node& head : level0_) {
+        while (head.next != &head) {
+            Node* node = head.next;
+            unlink(node);
+            node->timeout = 0;
+        }
+    }
+    for (Node& head : level1_) {
+        while (head.next != &head) {
+            Node* node = head.next;
+            unlink(node);
+            node->timeout = 0;
+        }
+    }
+}
+
+void TimingWheel::linkTail(Node* head, Node* node) {
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+void TimingWheel::unlink(Node* node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev = node->next = nullptr;
+}
+
+void TimingWheel::add(Node* node, uint32_t timeout, ExpireFunc onExpire) {
+    if (node->timeout != 0) {
+        remove(node);
+    }
+    if (timeout == 0) {
+        return;
+    }
+    node->timeout = timeout < kMaxTimeout ? timeout : kMaxTimeout;
+    node->onExpire = onExpire;
+    node->lastActive = now_;
+    node->deadline = now_ + node->timeout;
+    place(node);
+    ++size_;
+}
+
+void TimingWheel::remove(Node* node) {
+    if (node->timeout != 0) {
+        unlink(node);
+        node->timeout = 0;
+        --size_;
+    }
+}
+
+// 按deadline挂到对应的槽上，deadline必须在now_之后
+void TimingWheel::place(Node* node) {
+    uint32_t delta = node->deadline - now_;
+    if (delta < kLevel0Slots) {
+        linkTail(&level0_[node->deadline & (kLevel0Slots - 1)], node);
+    }
+    else {
+        linkTail(&level1_[(node->deadline >> kLevel0Bits) % kLevel1Slots], node);
+    }
+}
+
+// 第一级转完一圈，把第二级当前槽的节点下放到第一级
+void TimingWheel::cascade() {
+    Node& head = level1_[(now_ >> kLevel0Bits) % kLevel1Slots];
+    Node list;
+    list.prev = list.next = &list;
+    if (head.next != &head) {
+        list.next = head.next;
+        list.prev = head.prev;
+        list.next->prev = &list;
+        list.prev->next = &list;
+        head.prev = head.next = &head;
+    }
+    while (list.next != &list) {
+        Node* node = list.next;
+        unlink(node);
+        place(node);
+    }
+}
+
+void TimingWheel::tick() {
+    ++now_;
+    if ((now_ & (kLevel0Slots - 1)) == 0) {
+        cascade();
+    }
+
+    // 先把整个槽摘下来，回调里可能会对其他节点调用remove
+    Node& head = level0_[now_ & (kLevel0Slots - 1)];
+    if (head.next == &head) {
+        return;
+    }
+    Node list;
+    list.next = head.next;
+    list.prev = head.prev;
+    list.next->prev = &list;
+    list.prev->next = &list;
+    head.prev = head.next = &head;
+
+    while (list.next != &list) {
+        Node* node = list.next;
+        unlink(node);
+        uint32_t deadline = node->lastActive + node->timeout;
+        if (static_cast<int32_t>(deadline - now_) > 0) {
+            // 期间被touch过，按最近一次活跃时间重新计算到期时间
+            node->deadline = deadline;
+            place(node);
+        }
+        else {
+            node->timeout = 0;
+            --size_;
+            node->onExpire(node);
+        }
+    }
+}
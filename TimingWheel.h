@@ -0,0 +1,66 @@
+#pragma once
+
+#include "nocopyable.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+    两级时间轮，每个EventLoop一个，用于空闲连接的超时淘汰
+    - 第一级256个槽，每槽1个tick；第二级64个槽，每槽256个tick，最长约4.5小时
+    - 节点直接嵌在被管理的对象里（侵入式双向链表），加入、删除都是O(1)且不分配内存
+    - touch只记录最近活跃的tick，不移动节点；槽到期时再检查，未超时的节点按新的到期时间重新挂入
+    只能在所属loop的线程中使用
+*/
+class TimingWheel : nocopyable {
+public:
+    struct Node;
+    using ExpireFunc = void (*)(Node*);
+
+    struct Node {
+        Node()
+            : prev(nullptr), next(nullptr), onExpire(nullptr)
+            , deadline(0), lastActive(0), timeout(0) {
+
+        }
+
+        Node* prev;
+        Node* next;
+        ExpireFunc onExpire;    // 超时后回调，调用前节点已经从时间轮中摘除
+        uint32_t deadline;      // 节点所在槽的到期tick
+        uint32_t lastActive;    // 最近一次touch时的tick
+        uint32_t timeout;       // 超时的tick数，0表示不在时间轮中
+    };
+
+    static const uint32_t kLevel0Bits = 8;
+    static const uint32_t kLevel0Slots = 1u << kLevel0Bits;
+    static const uint32_t kLevel1Slots = 64;
+    static const uint32_t kMaxTimeout = kLevel0Slots * (kLevel1Slots - 1);
+
+    TimingWheel();
+    ~TimingWheel();
+
+    // 加入时间轮，timeout个tick内没有touch则回调node->onExpire
+    void add(Node* node, uint32_t timeout, ExpireFunc onExpire);
+    void remove(Node* node);
+    void touch(Node* node) { node->lastActive = now_; };
+
+    // 前进一个tick，处理到期的槽
+    void tick();
+
+    uint32_t now() const { return now_; };
+    size_t size() const { return size_; };
+
+private:
+    // 链表头使用哨兵节点
+    static void linkTail(Node* head, Node* node);
+    static void unlink(Node* node);
+
+    void place(Node* node);
+    void cascade();
+
+    uint32_t now_;
+    size_t size_;
+    Node level0_[kLevel0Slots];
+    Node level1_[kLevel1Slots];
+};
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <chrono>
+
+// 单调时钟的秒数，基准测试计时用
+inline double nowSeconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,112 @@
+#include "TcpServer.h"
+#include "TcpConnection.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include "BenchUtil.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <new>
+#include <string>
+#include <thread>
+
+/*
+    短连接的分配次数：客户端连上、发一个字节、收到回显后关闭，服务端一个IO线程
+    统计从建立到服务端销毁TcpConnection，平均每个连接的堆分配次数
+    客户端先关闭，TIME_WAIT留在客户端，loopback上默认的tcp_tw_reuse=2允许复用这些端口
+*/
+
+namespace {
+
+std::atomic<long> g_allocs(0);
+
+}
+
+void* operator new(size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+namespace {
+
+// 连接、发送、等回显、关闭，返回是否收到回显
+bool churnOne(const InetAddress& addr) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in serverAddr = *addr.getSockAddr();
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&serverAddr), sizeof serverAddr) < 0) {
+        ::close(fd);
+        return false;
+    }
+    char c = 'c';
+    bool ok = ::write(fd, &c, 1) == 1 && ::read(fd, &c, 1) == 1;
+    ::close(fd);
+    return ok;
+}
+
+}
+
+int main() {
+    Logger::setLogLevel(ERROR);
+    const long kWarmup = 1000;
+    const long kConnections = 20 * 1000;
+
+    EventLoop loop;
+    InetAddress addr(19985);
+    TcpServer server(&loop, addr, "Churn");
+    server.setThreadNum(1);
+    std::atomic<long> closed(0);
+    server.setConnectionCallback([&closed](const TcpConnectionPtr& conn) {
+        if (!conn->connected()) {
+            closed.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    server.setMessageCallback([](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+        conn->send(buf->retrieveAllAsString());
+    });
+    server.start();
+
+    std::thread client([&] {
+        // 等所有关闭都处理完，分配计数里不包含还没销毁的连接
+        auto waitClosed = [&closed](long n) {
+            while (closed.load(std::memory_order_relaxed) < n) {
+                usleep(1000);
+            }
+        };
+
+        for (long i = 0; i < kWarmup; ++i) {
+            churnOne(addr);
+        }
+        waitClosed(kWarmup);
+        usleep(100 * 1000);
+
+        long allocsBefore = g_allocs.load();
+        double start = nowSeconds();
+        long ok = 0;
+        for (long i = 0; i < kConnections; ++i) {
+            ok += churnOne(addr) ? 1 : 0;
+        }
+        waitClosed(kWarmup + kConnections);
+        double elapsed = nowSeconds() - start;
+        // 让io线程执行完排在关闭回调之后的connectDestory，TcpConnection在那之后才释放
+        usleep(100 * 1000);
+        long allocs = g_allocs.load() - allocsBefore;
+
+        printf("%ld connections (%ld echoed): %.0f conn/s, %.2f allocs/connection\n",
+               kConnections, ok, kConnections / elapsed, static_cast<double>(allocs) / kConnections);
+        loop.runInLoop([&loop] { loop.quit(); });
+    });
+    loop.loop();
+    client.join();
+    return 0;
+}
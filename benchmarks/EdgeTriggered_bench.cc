@@ -0,0 +1,164 @@
+#include "TcpServer.h"
+#include "TcpConnection.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include "BenchUtil.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/epoll.h>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+
+/*
+    水平触发和边沿触发的吞吐对比，服务端一个IO线程：
+    - 大块上传：客户端用64KB的write连续发送，服务端只计数丢弃，收齐后回一个字节
+    - 小消息回显：客户端一个线程逐条write 64字节的消息，另一个线程读回显
+    同时统计epoll_wait的次数(替换epoll_wait计数)和messageCallback的次数：
+    水平触发每次唤醒只读一次，边沿触发一次唤醒读到EAGAIN为止，epoll_wait应该更少
+*/
+
+namespace {
+
+std::atomic<long> g_waitCalls(0);
+
+}
+
+extern "C" int epoll_wait(int epfd, struct epoll_event* events, int maxevents, int timeout) {
+    g_waitCalls.fetch_add(1, std::memory_order_relaxed);
+    return static_cast<int>(::syscall(SYS_epoll_wait, epfd, events, maxevents, timeout));
+}
+
+namespace {
+
+int connectTo(const InetAddress& addr) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in serverAddr = *addr.getSockAddr();
+    while (::connect(fd, reinterpret_cast<sockaddr*>(&serverAddr), sizeof serverAddr) < 0) {
+        usleep(1000);
+    }
+    return fd;
+}
+
+bool writeAll(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::write(fd, data, len);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+void runBulk(bool edgeTriggered, uint16_t port) {
+    const size_t kTotal = 1024 * 1024 * 1024;
+    const std::string chunk(64 * 1024, 'b');
+
+    EventLoop loop;
+    InetAddress addr(port);
+    TcpServer server(&loop, addr, "BulkBench");
+    server.setThreadNum(1);
+    server.setEdgeTriggered(edgeTriggered);
+    std::atomic<long> callbacks(0);
+    size_t received = 0;
+    server.setConnectionCallback([](const TcpConnectionPtr&) {});
+    server.setMessageCallback([&](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+        ++callbacks;
+        received += buf->readableBytes();
+        buf->retrieveAll();
+        if (received == kTotal) {
+            conn->send("d", 1);
+        }
+    });
+    server.start();
+
+    std::thread client([&] {
+        int fd = connectTo(addr);
+        double start = nowSeconds();
+        long waitBase = g_waitCalls.load();
+        for (size_t sent = 0; sent < kTotal; sent += chunk.size()) {
+            writeAll(fd, chunk.data(), chunk.size());
+        }
+        char done;
+        ::read(fd, &done, 1);
+        double elapsed = nowSeconds() - start;
+        double megabytes = kTotal / 1e6;
+        printf("%-2s bulk 64KB writes: %10.0f MB/s   %8.2f epoll_wait/MB   %8.2f callbacks/MB\n",
+               edgeTriggered ? "ET" : "LT", megabytes / elapsed,
+               static_cast<double>(g_waitCalls.load() - waitBase) / megabytes,
+               static_cast<double>(callbacks.load()) / megabytes);
+        ::close(fd);
+        loop.runInLoop([&loop] { loop.quit(); });
+    });
+    loop.loop();
+    client.join();
+}
+
+void runSmall(bool edgeTriggered, uint16_t port) {
+    const long kMessages = 1000 * 1000;
+    const size_t kMessageSize = 64;
+
+    EventLoop loop;
+    InetAddress addr(port);
+    TcpServer server(&loop, addr, "SmallBench");
+    server.setThreadNum(1);
+    server.setEdgeTriggered(edgeTriggered);
+    std::atomic<long> callbacks(0);
+    server.setConnectionCallback([](const TcpConnectionPtr&) {});
+    server.setMessageCallback([&](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+        ++callbacks;
+        conn->send(buf->retrieveAllAsString());
+    });
+    server.start();
+
+    std::thread client([&] {
+        int fd = connectTo(addr);
+        double start = nowSeconds();
+        long waitBase = g_waitCalls.load();
+        std::thread writer([fd] {
+            char message[kMessageSize];
+            memset(message, 's', sizeof message);
+            for (long i = 0; i < kMessages; ++i) {
+                writeAll(fd, message, sizeof message);
+            }
+        });
+        const size_t total = kMessages * kMessageSize;
+        size_t got = 0;
+        char buf[65536];
+        while (got < total) {
+            ssize_t n = ::read(fd, buf, std::min(sizeof buf, total - got));
+            if (n <= 0) {
+                break;
+            }
+            got += n;
+        }
+        writer.join();
+        double elapsed = nowSeconds() - start;
+        printf("%-2s small 64B echo:   %10.0f msg/s  %8.3f epoll_wait/msg  %8.3f callbacks/msg\n",
+               edgeTriggered ? "ET" : "LT", kMessages / elapsed,
+               static_cast<double>(g_waitCalls.load() - waitBase) / kMessages,
+               static_cast<double>(callbacks.load()) / kMessages);
+        ::close(fd);
+        loop.runInLoop([&loop] { loop.quit(); });
+    });
+    loop.loop();
+    client.join();
+}
+
+}
+
+int main() {
+    Logger::setLogLevel(ERROR);
+    runBulk(false, 19986);
+    runBulk(true, 19987);
+    runSmall(false, 19988);
+    runSmall(true, 19989);
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include "TcpServer.h"
+#include "TcpConnection.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include "BenchUtil.h"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/epoll.h>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+
+/*
+    每个请求的epoll_ctl次数，通过替换epoll_ctl计数，不依赖Poller自己的统计
+    - 请求/响应：每个请求回16MB，超过loopback上自动调节后的发送缓冲区，服务端要等EPOLLOUT
+    - 分块下载：handleWrite发完一块关掉EPOLLOUT，同一轮的writeCompleteCallback里send下一块
+      又要打开EPOLLOUT，这是changelist能合并掉的情况
+*/
+
+namespace {
+
+std::atomic<long> g_ctlCalls(0);
+
+}
+
+extern "C" int epoll_ctl(int epfd, int op, int fd, struct epoll_event* event) {
+    g_ctlCalls.fetch_add(1, std::memory_order_relaxed);
+    return static_cast<int>(::syscall(SYS_epoll_ctl, epfd, op, fd, event));
+}
+
+namespace {
+
+// 接收缓冲区设小，响应一定写不完，要等EPOLLOUT
+int connectTo(const InetAddress& addr) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    int rcvbuf = 16 * 1024;
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+    sockaddr_in serverAddr = *addr.getSockAddr();
+    while (::connect(fd, reinterpret_cast<sockaddr*>(&serverAddr), sizeof serverAddr) < 0) {
+        usleep(1000);
+    }
+    return fd;
+}
+
+bool readExactly(int fd, size_t len) {
+    char buf[65536];
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = ::read(fd, buf, std::min(sizeof buf, len - got));
+        if (n <= 0) {
+            return false;
+        }
+        got += n;
+    }
+    return true;
+}
+
+void runRequestResponse() {
+    const int kRequests = 100;
+    const std::string response(16 * 1024 * 1024, 'r');
+
+    EventLoop loop;
+    InetAddress addr(19983);
+    TcpServer server(&loop, addr, "CtlRequest");
+    server.setThreadNum(1);
+    std::atomic<long> ctlBase(0);
+    server.setConnectionCallback([&](const TcpConnectionPtr& conn) {
+        if (conn->connected()) {
+            ctlBase = g_ctlCalls.load();
+        }
+    });
+    server.setMessageCallback([&](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+        size_t requests = buf->readableBytes();
+        buf->retrieveAll();
+        for (size_t i = 0; i < requests; ++i) {
+            conn->send(response);
+        }
+    });
+    server.start();
+
+    std::thread client([&] {
+        int fd = connectTo(addr);
+        double start = nowSeconds();
+        for (int i = 0; i < kRequests; ++i) {
+            ::write(fd, "q", 1);
+            readExactly(fd, response.size());
+        }
+        double elapsed = nowSeconds() - start;
+        printf("request/response 16MB:  %8.0f req/s  %8.2f epoll_ctl/request\n",
+               kRequests / elapsed, static_cast<double>(g_ctlCalls.load() - ctlBase) / kRequests);
+        ::close(fd);
+        loop.runInLoop([&loop] { loop.quit(); });
+    });
+    loop.loop();
+    client.join();
+}
+
+// 经典的分块下载：写完一块之后在writeCompleteCallback里send下一块
+void runStreaming() {
+    const int kChunks = 4000;
+    const std::string chunk(1024 * 1024, 'p');
+
+    EventLoop loop;
+    InetAddress addr(19984);
+    TcpServer server(&loop, addr, "CtlStream");
+    server.setThreadNum(1);
+    std::atomic<long> ctlBase(0);
+    std::atomic<int> sent(0);
+    server.setConnectionCallback([&](const TcpConnectionPtr& conn) {
+        if (conn->connected()) {
+            ctlBase = g_ctlCalls.load();
+            ++sent;
+            conn->send(chunk);
+        }
+    });
+    server.setWriteCompleteCallback([&](const TcpConnectionPtr& conn) {
+        if (sent < kChunks) {
+            ++sent;
+            conn->send(chunk);
+        }
+    });
+    server.start();
+
+    std::thread client([&] {
+        int fd = connectTo(addr);
+        double start = nowSeconds();
+        readExactly(fd, static_cast<size_t>(kChunks) * chunk.size());
+        double elapsed = nowSeconds() - start;
+        printf("streaming 1MB chunks:   %8.0f MB/s  %8.2f epoll_ctl/chunk\n",
+               kChunks * chunk.size() / elapsed / 1e6,
+               static_cast<double>(g_ctlCalls.load() - ctlBase) / kChunks);
+        ::close(fd);
+        loop.runInLoop([&loop] { loop.quit(); });
+    });
+    loop.loop();
+    client.join();
+}
+
+}
+
+int main() {
+    Logger::setLogLevel(ERROR);
+    runRequestResponse();
+    runStreaming();
+    return 0;
+}
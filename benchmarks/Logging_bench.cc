@@ -0,0 +1,101 @@
+#include "Logger.h"
+#include "AsyncLogging.h"
+#include "BenchUtil.h"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+    LOG_INFO每秒能写多少行，日志内容和库里常见的一行差不多长：
+    - 空输出端：只有格式化的开销，级别前缀、时间和printf风格的消息体
+    - /dev/null：默认输出端的写法，fwrite到一个FILE*
+    - AsyncLogging：前端memcpy进双缓冲，后台线程写文件
+    每种输出端分别用1个和4个线程同时写
+*/
+
+namespace {
+
+FILE* g_devNull = nullptr;
+AsyncLogging* g_asyncLog = nullptr;
+
+void nullOutput(const char*, int) {
+
+}
+
+void nullFlush() {
+
+}
+
+void devNullOutput(const char* msg, int len) {
+    fwrite(msg, 1, len, g_devNull);
+}
+
+void devNullFlush() {
+    fflush(g_devNull);
+}
+
+void asyncOutput(const char* msg, int len) {
+    g_asyncLog->append(msg, len);
+}
+
+void asyncFlush() {
+    g_asyncLog->flush();
+}
+
+void run(const char* name, int threads, long linesPerThread) {
+    std::vector<std::thread> writers;
+    double start = nowSeconds();
+    for (int t = 0; t < threads; ++t) {
+        writers.emplace_back([linesPerThread] {
+            for (long i = 0; i < linesPerThread; ++i) {
+                LOG_INFO("TcpServer::newConnection [%s] - new connection [%s-%ld] from %s",
+                         "EchoServer", "EchoServer", i, "127.0.0.1:54321");
+            }
+        });
+    }
+    for (std::thread& t : writers) {
+        t.join();
+    }
+    double elapsed = nowSeconds() - start;
+    long total = linesPerThread * threads;
+    printf("%-14s %2d threads %12.0f lines/s %8.0f ns/line\n",
+           name, threads, total / elapsed, elapsed / total * 1e9);
+}
+
+}
+
+int main() {
+    Logger::setLogLevel(INFO);
+    const long kLines = 2 * 1000 * 1000;
+    const int kThreads[] = {1, 4};
+
+    Logger::setOutput(nullOutput);
+    Logger::setFlush(nullFlush);
+    for (int threads : kThreads) {
+        run("null output", threads, kLines / threads);
+    }
+
+    g_devNull = fopen("/dev/null", "w");
+    Logger::setOutput(devNullOutput);
+    Logger::setFlush(devNullFlush);
+    for (int threads : kThreads) {
+        run("/dev/null", threads, kLines / threads);
+    }
+
+    char basename[64];
+    snprintf(basename, sizeof basename, "/tmp/logging_bench.%d", static_cast<int>(::getpid()));
+    g_asyncLog = new AsyncLogging(basename, 1000 * 1000 * 1000);
+    g_asyncLog->start();
+    Logger::setOutput(asyncOutput);
+    Logger::setFlush(asyncFlush);
+    for (int threads : kThreads) {
+        run("AsyncLogging", threads, kLines / threads);
+    }
+    g_asyncLog->stop();
+    printf("AsyncLogging dropped %ld lines, log files under %s.*\n",
+           static_cast<long>(g_asyncLog->droppedMessages()), basename);
+    return 0;
+}
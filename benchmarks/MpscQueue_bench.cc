@@ -0,0 +1,234 @@
+#include "MpscQueue.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "Task.h"
+#include "Logger.h"
+#include "BenchUtil.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+/*
+    回调队列的入队开销：
+    - 单线程入队再批量取出，对应loop线程内的queueInLoop
+    - 多个生产者线程同时入队、一个消费者线程取出，对比原来加锁swap vector的做法
+    - 经过EventLoop::queueInLoop的跨线程投递，包含唤醒
+    跨线程的两项中每个生产者最多有kWindow个回调未执行，否则生产者会一直跑在消费者前面，
+    队列无限增长，测到的只是分配新节点的速度
+    每一项都统计平均每次入队的堆分配次数，回调绑定一个shared_ptr，和绑定TcpConnection时一样
+*/
+
+namespace {
+
+std::atomic<long> g_allocs(0);
+
+}
+
+void* operator new(size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+namespace {
+
+// 原来的实现：加锁入队，消费者swap出整个vector
+class MutexQueue {
+public:
+    void push(Task task) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+
+    template <typename Func>
+    size_t consumeAll(Func&& func) {
+        std::vector<Task> tasks;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks.swap(tasks_);
+        }
+        for (Task& task : tasks) {
+            func(task);
+        }
+        return tasks.size();
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<Task> tasks_;
+};
+
+struct Result {
+    double mopsPerSec;
+    double allocsPerPush;
+};
+
+template <typename Queue>
+Result runSingleThread(long total) {
+    Queue queue;
+    std::shared_ptr<long> counter = std::make_shared<long>(0);
+    const int kBatch = 64;
+    // 先跑一轮预热，节点缓存和vector容量都就绪之后再计数
+    for (int i = 0; i < kBatch; ++i) {
+        queue.push([counter] { ++*counter; });
+    }
+    queue.consumeAll([](Task& task) { task(); });
+
+    long allocsBefore = g_allocs.load();
+    double start = nowSeconds();
+    for (long done = 0; done < total; done += kBatch) {
+        for (int i = 0; i < kBatch; ++i) {
+            queue.push([counter] { ++*counter; });
+        }
+        queue.consumeAll([](Task& task) { task(); });
+    }
+    double elapsed = nowSeconds() - start;
+    Result r;
+    r.mopsPerSec = total / elapsed / 1e6;
+    r.allocsPerPush = static_cast<double>(g_allocs.load() - allocsBefore) / total;
+    return r;
+}
+
+// 每个生产者最多有kWindow个回调未执行，模拟请求/响应式的投递，队列长度有上限
+const long kWindow = 256;
+
+void waitWindow(const std::atomic<long>& outstanding) {
+    while (outstanding.load(std::memory_order_relaxed) >= kWindow) {
+        std::this_thread::yield();
+    }
+}
+
+template <typename Queue>
+Result runContended(int producers, long perProducer) {
+    Queue queue;
+    std::atomic<bool> go(false);
+    std::atomic<int> finished(0);
+    long total = perProducer * producers;
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&] {
+            std::shared_ptr<std::atomic<long>> outstanding = std::make_shared<std::atomic<long>>(0);
+            while (!go.load()) {
+                std::this_thread::yield();
+            }
+            for (long i = 0; i < perProducer; ++i) {
+                waitWindow(*outstanding);
+                outstanding->fetch_add(1, std::memory_order_relaxed);
+                queue.push([outstanding] { outstanding->fetch_sub(1, std::memory_order_relaxed); });
+            }
+            waitWindow(*outstanding);
+            finished.fetch_add(1);
+        });
+    }
+
+    long allocsBefore = g_allocs.load();
+    double start = nowSeconds();
+    go = true;
+    long consumed = 0;
+    while (consumed < total) {
+        size_t n = queue.consumeAll([](Task& task) { task(); });
+        consumed += n;
+        if (n == 0) {
+            std::this_thread::yield();
+        }
+    }
+    double elapsed = nowSeconds() - start;
+    long allocs = g_allocs.load() - allocsBefore;
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    Result r;
+    r.mopsPerSec = total / elapsed / 1e6;
+    r.allocsPerPush = static_cast<double>(allocs) / total;
+    return r;
+}
+
+// 经过EventLoop::queueInLoop投递到另一个线程的loop
+Result runEventLoop(int producers, long perProducer) {
+    EventLoopThread thread;
+    EventLoop* loop = thread.startLoop();
+    std::atomic<long> executed(0);
+    long total = perProducer * producers;
+
+    std::atomic<bool> go(false);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&] {
+            std::shared_ptr<std::atomic<long>> outstanding = std::make_shared<std::atomic<long>>(0);
+            std::atomic<long>* counter = &executed;
+            while (!go.load()) {
+                std::this_thread::yield();
+            }
+            for (long i = 0; i < perProducer; ++i) {
+                waitWindow(*outstanding);
+                outstanding->fetch_add(1, std::memory_order_relaxed);
+                loop->queueInLoop([outstanding, counter] {
+                    outstanding->fetch_sub(1, std::memory_order_relaxed);
+                    counter->fetch_add(1, std::memory_order_relaxed);
+                });
+            }
+        });
+    }
+
+    long allocsBefore = g_allocs.load();
+    double start = nowSeconds();
+    go = true;
+    while (executed.load(std::memory_order_relaxed) < total) {
+        std::this_thread::yield();
+    }
+    double elapsed = nowSeconds() - start;
+    long allocs = g_allocs.load() - allocsBefore;
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    Result r;
+    r.mopsPerSec = total / elapsed / 1e6;
+    r.allocsPerPush = static_cast<double>(allocs) / total;
+    return r;
+}
+
+void print(const char* name, const Result& r) {
+    printf("%-28s %10.2f %12.3f\n", name, r.mopsPerSec, r.allocsPerPush);
+}
+
+}
+
+int main() {
+    Logger::setLogLevel(ERROR);
+    const long kSingle = 20 * 1000 * 1000;
+    // 跨线程的各项总投递数相同，平均分给各个生产者
+    const long kContended = 4 * 1000 * 1000;
+    char name[64];
+
+    printf("%-28s %10s %12s\n", "case", "Mops/s", "allocs/push");
+    print("single mutex+vector", runSingleThread<MutexQueue>(kSingle));
+    print("single mpsc", runSingleThread<MpscQueue<Task>>(kSingle));
+
+    const int kProducers[] = {1, 2, 4, 8, 16};
+    for (int producers : kProducers) {
+        snprintf(name, sizeof name, "%2d producers mutex+vector", producers);
+        print(name, runContended<MutexQueue>(producers, kContended / producers));
+        snprintf(name, sizeof name, "%2d producers mpsc", producers);
+        print(name, runContended<MpscQueue<Task>>(producers, kContended / producers));
+    }
+
+    for (int producers : kProducers) {
+        snprintf(name, sizeof name, "%2d producers queueInLoop", producers);
+        print(name, runEventLoop(producers, kContended / 4 / producers));
+    }
+    return 0;
+}
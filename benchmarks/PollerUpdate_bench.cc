@@ -0,0 +1,185 @@
+#include "EventLoop.h"
+#include "Channel.h"
+#include "Logger.h"
+#include "BenchUtil.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/epoll.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/*
+    Poller上add/mod/del的开销，大量fd同时注册：
+    - add：所有channel enableReading
+    - mod：所有channel再enableWriting
+    - del：所有channel disableAll之后remove
+    每个阶段在loop的回调里做完，下一次poll之前提交到内核，计时到下一个阶段开始，
+    包含Poller自己的查找和epoll_ctl
+    两组数据：
+    - 真实fd：用pipe的读端，空pipe的读端既不可读也不可写，注册之后不会有事件，
+      个数受RLIMIT_NOFILE限制(每个pipe两个fd)
+    - 只测用户态：替换epoll_ctl，对kFakeFdBase以上的fd直接返回成功，
+      fd只是编号，不用真的打开，可以注册到1M个，衡量Poller自己的查找和记录
+*/
+
+namespace {
+
+const int kFakeFdBase = 1000;
+std::atomic<bool> g_stubKernel(false);
+
+}
+
+extern "C" int epoll_ctl(int epfd, int op, int fd, struct epoll_event* event) {
+    if (g_stubKernel.load(std::memory_order_relaxed) && fd >= kFakeFdBase) {
+        return 0;
+    }
+    return static_cast<int>(::syscall(SYS_epoll_ctl, epfd, op, fd, event));
+}
+
+namespace {
+
+// 把软限制提到硬限制，返回能打开的fd个数
+long raiseFdLimit() {
+    struct rlimit rl;
+    ::getrlimit(RLIMIT_NOFILE, &rl);
+    rl.rlim_cur = rl.rlim_max;
+    ::setrlimit(RLIMIT_NOFILE, &rl);
+    ::getrlimit(RLIMIT_NOFILE, &rl);
+    return static_cast<long>(rl.rlim_cur);
+}
+
+class Bench {
+public:
+    Bench(EventLoop* loop, std::vector<std::unique_ptr<Channel>>* channels, int rounds)
+        : loop_(loop)
+        , channels_(channels)
+        , rounds_(rounds)
+        , round_(0)
+        , phaseStart_(0)
+        , addSeconds_(0)
+        , modSeconds_(0)
+        , delSeconds_(0) {
+
+    }
+
+    void start() { loop_->queueInLoop([this] { add(); }); };
+
+    void print() const {
+        double ops = static_cast<double>(channels_->size()) * rounds_;
+        printf("%-9s %8zu channels  add %7.1f ns  mod %7.1f ns  del %7.1f ns  (per channel, %d rounds)\n",
+               g_stubKernel ? "userspace" : "epoll", channels_->size(),
+               addSeconds_ / ops * 1e9, modSeconds_ / ops * 1e9, delSeconds_ / ops * 1e9, rounds_);
+    }
+
+private:
+    void add() {
+        phaseStart_ = nowSeconds();
+        for (std::unique_ptr<Channel>& channel : *channels_) {
+            channel->enableReading();
+        }
+        loop_->queueInLoop([this] { mod(); });
+    }
+
+    void mod() {
+        double now = nowSeconds();
+        addSeconds_ += now - phaseStart_;
+        phaseStart_ = now;
+        for (std::unique_ptr<Channel>& channel : *channels_) {
+            channel->enableWriting();
+        }
+        loop_->queueInLoop([this] { del(); });
+    }
+
+    void del() {
+        double now = nowSeconds();
+        modSeconds_ += now - phaseStart_;
+        phaseStart_ = now;
+        for (std::unique_ptr<Channel>& channel : *channels_) {
+            channel->disableAll();
+            channel->remove();
+        }
+        loop_->queueInLoop([this] { finishRound(); });
+    }
+
+    void finishRound() {
+        delSeconds_ += nowSeconds() - phaseStart_;
+        if (++round_ < rounds_) {
+            loop_->queueInLoop([this] { add(); });
+        }
+        else {
+            loop_->quit();
+        }
+    }
+
+    EventLoop* loop_;
+    std::vector<std::unique_ptr<Channel>>* channels_;
+    int rounds_;
+    int round_;
+    double phaseStart_;
+    double addSeconds_;
+    double modSeconds_;
+    double delSeconds_;
+};
+
+void run(size_t count, int rounds, bool stubKernel) {
+    EventLoop loop;
+    g_stubKernel = stubKernel;
+    std::vector<int> fds;
+    std::vector<std::unique_ptr<Channel>> channels;
+    for (size_t i = 0; i < count; ++i) {
+        if (stubKernel) {
+            channels.emplace_back(new Channel(&loop, kFakeFdBase + static_cast<int>(i)));
+            continue;
+        }
+        int pipefd[2];
+        if (::pipe2(pipefd, O_NONBLOCK | O_CLOEXEC) < 0) {
+            break;
+        }
+        fds.push_back(pipefd[0]);
+        fds.push_back(pipefd[1]);
+        channels.emplace_back(new Channel(&loop, pipefd[0]));
+    }
+
+    Bench bench(&loop, &channels, rounds);
+    bench.start();
+    loop.loop();
+    bench.print();
+
+    channels.clear();
+    for (int fd : fds) {
+        ::close(fd);
+    }
+    g_stubKernel = false;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    Logger::setLogLevel(ERROR);
+    // 留一些fd给epoll、eventfd和标准输入输出
+    long maxChannels = (raiseFdLimit() - 64) / 2;
+    if (argc > 1) {
+        maxChannels = std::min(maxChannels, atol(argv[1]));
+    }
+
+    const long kCounts[] = {1000, 10000, 100000, 1000000};
+    for (long count : kCounts) {
+        if (count > maxChannels) {
+            printf("RLIMIT_NOFILE allows %ld channels\n", maxChannels);
+            run(maxChannels, static_cast<int>(std::max(5L, 1000000 / maxChannels)), false);
+            break;
+        }
+        run(count, static_cast<int>(std::max(5L, 1000000 / count)), false);
+    }
+    for (long count : kCounts) {
+        run(count, static_cast<int>(std::max(5L, 1000000 / count)), true);
+    }
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include "Buffer.h"
+#include "EventLoop.h"
+#include "AdaptiveRecvSizer.h"
+#include "Logger.h"
+#include "BenchUtil.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <string>
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+/*
+    Buffer::readFd每读一个字节的开销，数据从socketpair读出，只计readFd本身：
+    - 原来的做法：栈上64KB的extrabuf每次清零
+    - 栈上64KB的extrabuf，不清零
+    - 借用loop的临时接收区，readv的上限由AdaptiveRecvSizer决定，和TcpConnection::handleRead一样
+    小消息时Buffer自己的空间就放得下，extrabuf只是备用，清零64KB是主要开销
+    cycles按TSC计数，非x86平台只输出ns
+*/
+
+namespace {
+
+uint64_t readCycles() {
+#if defined(__x86_64__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+enum Mode {
+    kZeroedStack,
+    kStack,
+    kLoopScratch,
+};
+
+const char* const kModeNames[] = {
+    "zeroed stack 64KB",
+    "stack 64KB",
+    "loop scratch+adaptive",
+};
+
+void run(Mode mode, EventLoop* loop, size_t messageSize, long messages) {
+    int fds[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    std::string message(messageSize, 'm');
+    Buffer buffer;
+    AdaptiveRecvSizer sizer;
+
+    uint64_t cycles = 0;
+    double seconds = 0;
+    size_t bytes = 0;
+    for (long i = 0; i < messages; ++i) {
+        ::write(fds[1], message.data(), message.size());
+        int savedErrno = 0;
+        ssize_t n = 0;
+        double start = nowSeconds();
+        uint64_t startCycles = readCycles();
+        if (mode == kZeroedStack) {
+            char extrabuf[65536] = {0};
+            n = buffer.readFd(fds[0], &savedErrno, extrabuf, sizeof extrabuf);
+        }
+        else if (mode == kStack) {
+            n = buffer.readFd(fds[0], &savedErrno);
+        }
+        else {
+            size_t extraLen = std::min(sizer.guess(), EventLoop::kRecvScratchSize);
+            n = buffer.readFd(fds[0], &savedErrno, loop->recvScratch(), extraLen);
+            if (n > 0) {
+                sizer.record(n);
+            }
+        }
+        cycles += readCycles() - startCycles;
+        seconds += nowSeconds() - start;
+        if (n > 0) {
+            bytes += n;
+        }
+        // 一次没读完的部分下一轮接着读，和handleRead一样不在这里循环
+        buffer.retrieveAll();
+    }
+    ::close(fds[0]);
+    ::close(fds[1]);
+
+    printf("%8zu %-24s %10.1f %12.3f %12.3f\n", messageSize, kModeNames[mode],
+           seconds / messages * 1e9, seconds / bytes * 1e9,
+           static_cast<double>(cycles) / bytes);
+}
+
+}
+
+int main() {
+    Logger::setLogLevel(ERROR);
+    EventLoop loop;
+    const size_t kSizes[] = {16, 256, 4096, 65536};
+
+    printf("%8s %-24s %10s %12s %12s\n", "size", "extrabuf", "ns/read", "ns/byte", "cycles/byte");
+    for (size_t size : kSizes) {
+        long messages = static_cast<long>(std::max<size_t>(20000, 256 * 1024 * 1024 / size / 64));
+        messages = std::min(messages, 200 * 1000L);
+        run(kZeroedStack, &loop, size, messages);
+        run(kStack, &loop, size, messages);
+        run(kLoopScratch, &loop, size, messages);
+    }
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include "SimdSearch.h"
+#include "BenchUtil.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+/*
+    各实现的查找吞吐：
+    - 在1MB没有分隔符的数据上查找，衡量长距离扫描
+    - 把64KB的类HTTP头按"\r\n"逐行切分，行长20~80字节，衡量短距离查找和尾部处理
+*/
+
+namespace {
+
+std::string makeLines(size_t total) {
+    std::string s;
+    while (s.size() < total) {
+        size_t len = 20 + rand() % 60;
+        for (size_t i = 0; i < len; ++i) {
+            s.push_back(static_cast<char>('a' + rand() % 26));
+        }
+        s += "\r\n";
+    }
+    return s;
+}
+
+}
+
+int main() {
+    srand(1);
+    std::string noMatch(1024 * 1024, 'a');
+    std::string lines = makeLines(64 * 1024);
+    size_t lineCount = 0;
+
+    printf("%-8s %14s %14s %14s\n", "impl", "findByte GB/s", "findCRLF GB/s", "lines M/s");
+    for (const SimdSearch::Impl& impl : SimdSearch::availableImpls()) {
+        const int kScanRounds = 2000;
+        double start = nowSeconds();
+        size_t sink = 0;
+        for (int i = 0; i < kScanRounds; ++i) {
+            sink += impl.findByte(noMatch.data(), noMatch.data() + noMatch.size(), '\n') == nullptr;
+        }
+        double byteSec = nowSeconds() - start;
+
+        start = nowSeconds();
+        for (int i = 0; i < kScanRounds; ++i) {
+            sink += impl.findCRLF(noMatch.data(), noMatch.data() + noMatch.size()) == nullptr;
+        }
+        double crlfSec = nowSeconds() - start;
+
+        const int kLineRounds = 2000;
+        lineCount = 0;
+        start = nowSeconds();
+        for (int i = 0; i < kLineRounds; ++i) {
+            const char* p = lines.data();
+            const char* end = p + lines.size();
+            const char* crlf;
+            while ((crlf = impl.findCRLF(p, end)) != nullptr) {
+                p = crlf + 2;
+                ++lineCount;
+            }
+        }
+        double lineSec = nowSeconds() - start;
+
+        double scanned = static_cast<double>(noMatch.size()) * kScanRounds / 1e9;
+        printf("%-8s %14.2f %14.2f %14.1f%s\n", impl.name,
+               scanned / byteSec, scanned / crlfSec, lineCount / lineSec / 1e6,
+               sink == 0 ? " (unexpected match)" : "");
+    }
+    printf("dispatched implementation: %s\n", SimdSearch::implName());
+    return 0;
+}
@@ -0,0 +1,169 @@
+#include "Task.h"
+#include "TcpServer.h"
+#include "TcpConnection.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "Logger.h"
+#include "BenchUtil.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+    EventLoop::Functor从std::function换成Task之后的分配次数：
+    - 库里常见的几种回调分别用std::function和Task构造、移动进队列、执行、析构
+    - 回显：IO线程把收到的消息交给工作线程，工作线程再send回去，
+      每条消息经过两次跨线程投递，统计每条消息的堆分配次数
+*/
+
+namespace {
+
+std::atomic<long> g_allocs(0);
+
+}
+
+void* operator new(size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+namespace {
+
+// 和TcpConnection的成员函数签名一样的替身
+struct Conn {
+    void sendStringInLoop(const std::string& message) { bytes += message.size(); };
+    void connectDestory() { ++calls; };
+
+    size_t bytes = 0;
+    long calls = 0;
+};
+
+template <typename Functor, typename Make>
+void runCallable(const char* functorName, const char* callableName, Make make) {
+    const long kRounds = 5 * 1000 * 1000;
+    std::vector<Functor> queue;
+    queue.reserve(64);
+
+    long allocsBefore = g_allocs.load();
+    double start = nowSeconds();
+    for (long i = 0; i < kRounds; i += 64) {
+        for (int j = 0; j < 64; ++j) {
+            queue.push_back(make());
+        }
+        for (Functor& f : queue) {
+            f();
+        }
+        queue.clear();
+    }
+    double elapsed = nowSeconds() - start;
+    printf("%-14s %-26s %10.1f %12.3f\n", functorName, callableName,
+           elapsed / kRounds * 1e9,
+           static_cast<double>(g_allocs.load() - allocsBefore) / kRounds);
+}
+
+template <typename Functor>
+void runCallables(const char* functorName) {
+    std::shared_ptr<Conn> conn = std::make_shared<Conn>();
+    runCallable<Functor>(functorName, "bind(conn)", [&] {
+        return Functor(std::bind(&Conn::connectDestory, conn));
+    });
+    runCallable<Functor>(functorName, "bind(conn, string)", [&] {
+        // 15字节以内的string不分配内存，计数只反映回调本身
+        return Functor(std::bind(&Conn::sendStringInLoop, conn, std::string("short message")));
+    });
+    runCallable<Functor>(functorName, "lambda[conn, string]", [&] {
+        std::string message("short message");
+        return Functor([conn, message] { conn->sendStringInLoop(message); });
+    });
+}
+
+void runEcho() {
+    const long kMessages = 100 * 1000;
+    const size_t kMessageSize = 15;
+
+    EventLoop loop;
+    InetAddress addr(19981);
+    TcpServer server(&loop, addr, "TaskBench");
+    server.setThreadNum(1);
+    EventLoopThread workerThread;
+    EventLoop* worker = workerThread.startLoop();
+
+    server.setConnectionCallback([](const TcpConnectionPtr&) {});
+    server.setMessageCallback([worker](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+        std::string message = buf->retrieveAllAsString();
+        worker->queueInLoop([conn, message]() mutable {
+            conn->send(std::move(message));
+        });
+    });
+    server.start();
+
+    long allocs = 0;
+    double elapsed = 0;
+    std::thread client([&] {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in serverAddr = *addr.getSockAddr();
+        while (::connect(fd, reinterpret_cast<sockaddr*>(&serverAddr), sizeof serverAddr) < 0) {
+            usleep(1000);
+        }
+        char message[kMessageSize];
+        memset(message, 'm', sizeof message);
+        char reply[kMessageSize];
+        // 先跑一段，让连接、缓冲区和队列节点都就绪
+        const long kWarmup = 1000;
+        long allocsBefore = 0;
+        double start = 0;
+        for (long i = 0; i < kWarmup + kMessages; ++i) {
+            if (i == kWarmup) {
+                allocsBefore = g_allocs.load();
+                start = nowSeconds();
+            }
+            ::write(fd, message, sizeof message);
+            size_t got = 0;
+            while (got < sizeof reply) {
+                ssize_t n = ::read(fd, reply + got, sizeof reply - got);
+                if (n <= 0) {
+                    break;
+                }
+                got += n;
+            }
+        }
+        elapsed = nowSeconds() - start;
+        allocs = g_allocs.load() - allocsBefore;
+        ::close(fd);
+        loop.runInLoop([&loop] { loop.quit(); });
+    });
+    loop.loop();
+    client.join();
+
+    printf("echo via worker thread: %ld messages, %.1f us/round trip, %.3f allocs/message\n",
+           kMessages, elapsed / kMessages * 1e6, static_cast<double>(allocs) / kMessages);
+}
+
+}
+
+int main() {
+    Logger::setLogLevel(ERROR);
+    printf("%-14s %-26s %10s %12s\n", "functor", "callable", "ns/op", "allocs/op");
+    runCallables<std::function<void()>>("std::function");
+    runCallables<Task>("Task");
+    runEcho();
+    return 0;
+}
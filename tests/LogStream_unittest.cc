@@ -0,0 +1,132 @@
+#include "LogStream.h"
+
+#include <limits.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <wchar.h>
+#include <string>
+
+/*
+    对比LogStream和snprintf：
+    - appendFormat对各种转换、长度修饰符、标志、宽度和精度的输出与vsnprintf一致，包括边界值
+    - 缓冲区放不下时截断，不越界
+    - operator<<的整数、指针和double输出
+*/
+
+namespace {
+
+int g_failures = 0;
+
+void expectEqual(const char* what, const std::string& expected, const std::string& actual) {
+    if (expected != actual) {
+        ++g_failures;
+        if (g_failures <= 20) {
+            fprintf(stderr, "FAIL %s expected=\"%s\" actual=\"%s\"\n", what, expected.c_str(), actual.c_str());
+        }
+    }
+}
+
+void checkFormat(const char* fmt, ...) {
+    char expected[kSmallBuffer];
+    va_list args;
+    va_start(args, fmt);
+    va_list copy;
+    va_copy(copy, args);
+    vsnprintf(expected, sizeof expected, fmt, args);
+    va_end(args);
+
+    LogStream stream;
+    stream.appendFormat(fmt, copy);
+    va_end(copy);
+    expectEqual(fmt, expected, stream.buffer().toString());
+}
+
+void testConversions() {
+    checkFormat("plain text");
+    checkFormat("");
+    checkFormat("%d %d %d %d", 0, -1, INT_MAX, INT_MIN);
+    checkFormat("%i|%u|%u", 42, 0u, UINT_MAX);
+    checkFormat("%ld %ld %lu", LONG_MAX, LONG_MIN, ULONG_MAX);
+    checkFormat("%lld %lld %llu", LLONG_MAX, LLONG_MIN, ULLONG_MAX);
+    checkFormat("%hd %hu %hhd %hhu", 70000, 70000, 300, 300);
+    checkFormat("%zu %zd %jd %ju %td", static_cast<size_t>(SIZE_MAX), static_cast<ssize_t>(-5),
+                static_cast<intmax_t>(INTMAX_MIN), static_cast<uintmax_t>(UINTMAX_MAX),
+                static_cast<ptrdiff_t>(-7));
+    checkFormat("%s|%s|%c%c", "hello", "", 'a', 'z');
+    checkFormat("%s", static_cast<const char*>(nullptr));
+    checkFormat("%p %p", reinterpret_cast<void*>(0x7f001234abcdUL), static_cast<void*>(nullptr));
+    checkFormat("100%% done %d%%", 5);
+    checkFormat("%x %X %o %#x %lx %llX", 255u, 255u, 8u, 255u, ULONG_MAX, 0xabcULL);
+    checkFormat("fd=%d events=%d index=%d name=%s", 12, 3, -1, "conn#1");
+}
+
+void testFlagsWidthPrecision() {
+    checkFormat("[%5d] [%-5d] [%05d] [%+d] [% d]", 42, 42, 42, 42, 42);
+    checkFormat("[%10s] [%-10s] [%.3s] [%*d] [%-*d]", "abc", "abc", "abcdef", 6, 7, 6, 7);
+    checkFormat("[%.*s] [%*.*f]", 2, "xyz", 8, 2, 3.14159);
+    checkFormat("[%5hd] [%08lld] [%-3zu]", 12, -12LL, static_cast<size_t>(9));
+    checkFormat("[%20p] [%5c] [%lc]", reinterpret_cast<void*>(0x1234), 'q', static_cast<wint_t>('w'));
+    checkFormat("%f %e %g %.2f %G", 1.5, 12345.678, 0.0001, -2.005, 1e300);
+    checkFormat("%Lf %a", static_cast<long double>(2.5), 1.0);
+}
+
+void testMalformed() {
+    checkFormat("tail %");
+    checkFormat("unknown %y here");
+}
+
+void testTruncation() {
+    std::string big(kSmallBuffer * 2, 'b');
+    LogStream stream;
+    stream.append("x", 1);
+    // 长字符串截断到缓冲区剩余空间，留一个字节不写
+    struct Helper {
+        static void format(LogStream& s, const char* fmt, ...) {
+            va_list args;
+            va_start(args, fmt);
+            s.appendFormat(fmt, args);
+            va_end(args);
+        }
+    };
+    Helper::format(stream, "%s%d", big.c_str(), 12345);
+    if (stream.buffer().length() != kSmallBuffer - 1 || stream.buffer().avail() != 1) {
+        ++g_failures;
+        fprintf(stderr, "FAIL truncation length=%d avail=%zu\n", stream.buffer().length(), stream.buffer().avail());
+    }
+}
+
+void testStreamOperators() {
+    LogStream stream;
+    stream << 0 << ' ' << -123 << ' ' << LLONG_MIN << ' ' << ULLONG_MAX << ' '
+           << static_cast<short>(-5) << ' ' << true << ' ' << "str" << ' ' << std::string("s2");
+    char expected[256];
+    snprintf(expected, sizeof expected, "0 -123 %lld %llu -5 1 str s2", LLONG_MIN, ULLONG_MAX);
+    expectEqual("operator<< integers", expected, stream.buffer().toString());
+
+    stream.resetBuffer();
+    stream << reinterpret_cast<const void*>(0xdeadbeefUL);
+    expectEqual("operator<< pointer", "0xdeadbeef", stream.buffer().toString());
+
+    stream.resetBuffer();
+    stream << 3.0 << ' ' << 0.1 << ' ' << -2.5e20;
+    snprintf(expected, sizeof expected, "%.12g %.12g %.12g", 3.0, 0.1, -2.5e20);
+    expectEqual("operator<< double", expected, stream.buffer().toString());
+}
+
+}
+
+int main() {
+    testConversions();
+    testFlagsWidthPrecision();
+    testMalformed();
+    testTruncation();
+    testStreamOperators();
+    if (g_failures > 0) {
+        fprintf(stderr, "%d failures\n", g_failures);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include "SimdSearch.h"
+#include "Buffer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+/*
+    对比每个SIMD实现和逐字节的参考实现：
+    - 长度0~128的每一种区间，分隔符放在每一个位置上，以及区间内没有分隔符的情况
+    - 区间起点相对16/32字节对齐的每一种偏移
+    - 区间外紧挨着的字节是分隔符，或者'\r'在最后一个字节而'\n'在区间外，都不能被找到
+*/
+
+namespace {
+
+const int kMaxLen = 128;
+const int kMaxOffset = 32;
+
+int g_failures = 0;
+
+void check(const char* what, const char* impl, int offset, int len, int pos,
+           const char* expected, const char* actual, const char* base) {
+    if (expected != actual) {
+        ++g_failures;
+        if (g_failures <= 20) {
+            fprintf(stderr, "FAIL %s impl=%s offset=%d len=%d pos=%d expected=%ld actual=%ld\n",
+                    what, impl, offset, len, pos,
+                    expected ? static_cast<long>(expected - base) : -1L,
+                    actual ? static_cast<long>(actual - base) : -1L);
+        }
+    }
+}
+
+// 用不含'\r'、'\n'和'x'的随机字节填充
+void fillNoise(char* buf, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        char c;
+        do {
+            c = static_cast<char>(rand() & 0xff);
+        } while (c == '\r' || c == '\n' || c == 'x');
+        buf[i] = c;
+    }
+}
+
+void testFindByte(const SimdSearch::Impl& ref, const SimdSearch::Impl& impl) {
+    char storage[kMaxOffset + kMaxLen + 64];
+    for (int offset = 0; offset < kMaxOffset; ++offset) {
+        for (int len = 0; len <= kMaxLen; ++len) {
+            // pos == len表示区间内没有分隔符
+            for (int pos = 0; pos <= len; ++pos) {
+                fillNoise(storage, sizeof storage);
+                char* begin = storage + offset;
+                char* end = begin + len;
+                *end = 'x';     // 区间外紧挨着的字节
+                if (pos < len) {
+                    begin[pos] = 'x';
+                    // 之后再放一个，必须返回第一个
+                    if (pos + 7 < len) {
+                        begin[pos + 7] = 'x';
+                    }
+                }
+                const char* expected = pos < len ? begin + pos : nullptr;
+                check("findByte(ref)", ref.name, offset, len, pos, expected, ref.findByte(begin, end, 'x'), begin);
+                check("findByte", impl.name, offset, len, pos, expected, impl.findByte(begin, end, 'x'), begin);
+            }
+        }
+    }
+}
+
+void testFindCRLF(const SimdSearch::Impl& ref, const SimdSearch::Impl& impl) {
+    char storage[kMaxOffset + kMaxLen + 64];
+    for (int offset = 0; offset < kMaxOffset; ++offset) {
+        for (int len = 0; len <= kMaxLen; ++len) {
+            for (int pos = 0; pos <= len; ++pos) {
+                fillNoise(storage, sizeof storage);
+                char* begin = storage + offset;
+                char* end = begin + len;
+                // 区间最后一个字节是'\r'，'\n'在区间外，不算找到
+                if (len > 0) {
+                    end[-1] = '\r';
+                }
+                *end = '\n';
+                if (pos + 1 < len) {
+                    begin[pos] = '\r';
+                    begin[pos + 1] = '\n';
+                    // 前面放单独的'\n'和不跟'\n'的'\r'干扰
+                    if (pos >= 2) {
+                        begin[pos - 2] = '\n';
+                        begin[pos - 1] = '\r';
+                    }
+                }
+                const char* expected = pos + 1 < len ? begin + pos : nullptr;
+                check("findCRLF(ref)", ref.name, offset, len, pos, expected, ref.findCRLF(begin, end), begin);
+                check("findCRLF", impl.name, offset, len, pos, expected, impl.findCRLF(begin, end), begin);
+            }
+        }
+    }
+}
+
+void testBuffer() {
+    Buffer buf;
+    std::string line(100, 'a');
+    buf.append(line.data(), line.size());
+    if (buf.findCRLF() != nullptr || buf.findEOL() != nullptr) {
+        ++g_failures;
+        fprintf(stderr, "FAIL Buffer found a delimiter in \"aaa...\"\n");
+    }
+    buf.append("\r\n", 2);
+    if (buf.findCRLF() != buf.peek() + line.size() || buf.findEOL() != buf.peek() + line.size() + 1) {
+        ++g_failures;
+        fprintf(stderr, "FAIL Buffer delimiter position\n");
+    }
+}
+
+}
+
+int main() {
+    srand(12345);
+    const std::vector<SimdSearch::Impl>& impls = SimdSearch::availableImpls();
+    const SimdSearch::Impl& ref = impls[0];
+    for (const SimdSearch::Impl& impl : impls) {
+        printf("checking %s\n", impl.name);
+        testFindByte(ref, impl);
+        testFindCRLF(ref, impl);
+    }
+    testBuffer();
+
+    printf("dispatched implementation: %s\n", SimdSearch::implName());
+    if (g_failures > 0) {
+        printf("%d failures\n", g_failures);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include "EventLoop.h"
+#include "Logger.h"
+#include "Timestamp.h"
+
+#include <stdio.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <atomic>
+
+/*
+    默认时钟是粗粒度时钟时的定时器唤醒次数：
+    - 粗粒度时钟最多比timerfd用的CLOCK_MONOTONIC落后一个jiffy，
+      handleRead如果拿它判断到期，定时器会在100微秒的下限上反复重设，直到时钟跳过一个jiffy
+    - 一个接一个地挂不到一个jiffy的短定时器，统计epoll_wait的次数，
+      每个定时器应该只唤醒一两次，并且执行时精确时钟已经过了到期时间
+*/
+
+namespace {
+
+std::atomic<long> g_waitCalls(0);
+
+}
+
+extern "C" int epoll_wait(int epfd, struct epoll_event* events, int maxevents, int timeout) {
+    g_waitCalls.fetch_add(1, std::memory_order_relaxed);
+    return static_cast<int>(::syscall(SYS_epoll_wait, epfd, events, maxevents, timeout));
+}
+
+namespace {
+
+int g_failures = 0;
+
+const int kTimers = 200;
+const double kDelay = 0.0003;
+
+class Chain {
+public:
+    explicit Chain(EventLoop* loop)
+        : loop_(loop)
+        , fired_(0)
+        , early_(0)
+        , due_() {
+
+    }
+
+    void start() { schedule(); };
+
+    int early() const { return early_; };
+
+private:
+    void schedule() {
+        // 到期时间按默认时钟算，和runAfter一致
+        due_ = addTime(Timestamp::now(), kDelay);
+        loop_->runAfter(kDelay, [this] { fire(); });
+    }
+
+    void fire() {
+        if (Timestamp::now(Timestamp::kMonotonic) < due_) {
+            ++early_;
+        }
+        if (++fired_ < kTimers) {
+            schedule();
+        }
+        else {
+            loop_->quit();
+        }
+    }
+
+    EventLoop* loop_;
+    int fired_;
+    int early_;
+    Timestamp due_;
+};
+
+void testCoarseClockWakeups(Timestamp::Clock clock, const char* name) {
+    Timestamp::setDefaultClock(clock);
+    EventLoop loop;
+    Chain chain(&loop);
+    chain.start();
+    long base = g_waitCalls.load();
+    loop.loop();
+    double perTimer = static_cast<double>(g_waitCalls.load() - base) / kTimers;
+    if (perTimer > 3) {
+        ++g_failures;
+        fprintf(stderr, "FAIL %s: %.1f epoll_wait per timer\n", name, perTimer);
+    }
+    if (chain.early() > 0) {
+        ++g_failures;
+        fprintf(stderr, "FAIL %s: %d timers fired early\n", name, chain.early());
+    }
+}
+
+}
+
+int main() {
+    Logger::setLogLevel(ERROR);
+    testCoarseClockWakeups(Timestamp::kMonotonicCoarse, "kMonotonicCoarse");
+    testCoarseClockWakeups(Timestamp::kMonotonic, "kMonotonic");
+    if (g_failures > 0) {
+        fprintf(stderr, "%d failures\n", g_failures);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}